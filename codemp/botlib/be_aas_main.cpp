@@ -268,6 +268,8 @@ int AAS_LoadMap(const char *mapname)
 	// to free the caches the old number of areas, number of clusters
 	// and number of areas in a clusters must be available
 	AAS_FreeRoutingCaches();
+	//the routing tables of the old map live in the map arena
+	FreeMapMemory();
 	//load the map
 	errnum = AAS_LoadFiles(mapname);
 	if (errnum != BLERR_NOERROR)
@@ -325,6 +327,8 @@ void AAS_Shutdown(void)
 	AAS_DumpBSPData();
 	//free routing caches
 	AAS_FreeRoutingCaches();
+	//free the routing tables in one go
+	FreeMapMemory();
 	//free aas link heap
 	AAS_FreeAASLinkHeap();
 	//free aas linked entities
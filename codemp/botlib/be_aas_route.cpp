@@ -50,6 +50,13 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "be_interface.h"
 #include "be_aas_def.h"
 
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #define ROUTING_DEBUG
 
 //travel time in hundreths of a second = distance * 100 / speed
@@ -89,6 +96,46 @@ int numportalcacheupdates;
 int routingcachesize;
 int max_routingcachesize;
 
+/*
+
+  routing workers:
+  area routing caches only read the AAS world and write into their own
+  travel times, so they can be filled in on worker threads. The caches
+  are still allocated and linked on the main thread and flagged pending
+  until a worker finished them. Only a query for a pending cache waits.
+
+*/
+
+static std::vector<std::thread> routingworkers;
+static std::vector<aas_routingupdate_t *> routingworkerupdates;
+static std::deque<aas_routingcache_t *> routingjobs;
+static std::mutex routingmutex;
+static std::condition_variable routingjobready;
+static std::condition_variable routingjobdone;
+static std::atomic<int> numpendingcaches(0);
+static bool routingworkersquit;
+static int numprefetchedcaches;
+//set when caches were computed that aren't in the route cache file yet
+static qboolean routingcachechanged;
+
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate);
+aas_routingcache_t *AAS_AllocRoutingCache(int numtraveltimes);
+void AAS_FinishRoutingJobs(void);
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				true if a routing worker hasn't filled in the cache yet
+// Changes Globals:		-
+//===========================================================================
+static bool AAS_RoutingCachePending(aas_routingcache_t *cache)
+{
+	if (!numpendingcaches.load())
+		return false;
+	std::lock_guard<std::mutex> lock(routingmutex);
+	return cache->pending != 0;
+} //end of the function AAS_RoutingCachePending
+
 //===========================================================================
 //
 // Parameter:			-
@@ -101,6 +148,7 @@ void AAS_RoutingInfo(void)
 	botimport.Print(PRT_MESSAGE, "%d area cache updates\n", numareacacheupdates);
 	botimport.Print(PRT_MESSAGE, "%d portal cache updates\n", numportalcacheupdates);
 	botimport.Print(PRT_MESSAGE, "%d bytes routing cache\n", routingcachesize);
+	botimport.Print(PRT_MESSAGE, "%d area caches prefetched by %d routing workers\n", numprefetchedcaches, (int)routingworkers.size());
 } //end of the function AAS_RoutingInfo
 #endif //ROUTING_DEBUG
 //===========================================================================
@@ -231,6 +279,7 @@ void AAS_LinkCache(aas_routingcache_t *cache)
 	} //end else
 	cache->time_next = NULL;
 	aasworld.newestcache = cache;
+	routingcachechanged = qtrue;
 } //end of the function AAS_LinkCache
 //===========================================================================
 //
@@ -258,6 +307,7 @@ void AAS_RemoveRoutingCacheInCluster( int clusternum )
 
 	if (!aasworld.clusterareacache)
 		return;
+	AAS_FinishRoutingJobs();
 	cluster = &aasworld.clusters[clusternum];
 	for (i = 0; i < cluster->numareas; i++)
 	{
@@ -325,17 +375,18 @@ int AAS_EnableRoutingArea(int areanum, int enable)
 	flags = aasworld.areasettings[areanum].areaflags & AREA_DISABLED;
 	if (enable < 0)
 		return !flags;
+	//nothing changes, don't wait for the routing workers
+	if (!enable == !!flags)
+		return !flags;
+	//routing workers read the area flags
+	AAS_FinishRoutingJobs();
 
 	if (enable)
 		aasworld.areasettings[areanum].areaflags &= ~AREA_DISABLED;
 	else
 		aasworld.areasettings[areanum].areaflags |= AREA_DISABLED;
-	// if the status of the area changed
-	if ( (flags & AREA_DISABLED) != (aasworld.areasettings[areanum].areaflags & AREA_DISABLED) )
-	{
-		//remove all routing cache involving this area
-		AAS_RemoveRoutingCacheUsingArea( areanum );
-	} //end if
+	//remove all routing cache involving this area
+	AAS_RemoveRoutingCacheUsingArea( areanum );
 	return !flags;
 } //end of the function AAS_EnableRoutingArea
 //===========================================================================
@@ -409,7 +460,7 @@ void AAS_InitAreaContentsTravelFlags(void)
 	int i;
 
 	if (aasworld.areacontentstravelflags) FreeMemory(aasworld.areacontentstravelflags);
-	aasworld.areacontentstravelflags = (int *) GetClearedMemory(aasworld.numareas * sizeof(int));
+	aasworld.areacontentstravelflags = (int *) GetClearedMapMemory(aasworld.numareas * sizeof(int));
 	//
 	for (i = 0; i < aasworld.numareas; i++) {
 		aasworld.areacontentstravelflags[i] = AAS_GetAreaContentsTravelFlags(i);
@@ -436,7 +487,7 @@ void AAS_CreateReversedReachability(void)
 	//free reversed links that have already been created
 	if (aasworld.reversedreachability) FreeMemory(aasworld.reversedreachability);
 	//allocate memory for the reversed reachability links
-	ptr = (char *) GetClearedMemory(aasworld.numareas * sizeof(aas_reversedreachability_t) +
+	ptr = (char *) GetClearedMapMemory(aasworld.numareas * sizeof(aas_reversedreachability_t) +
 							aasworld.reachabilitysize * sizeof(aas_reversedlink_t));
 	//
 	aasworld.reversedreachability = (aas_reversedreachability_t *) ptr;
@@ -532,7 +583,7 @@ void AAS_CalculateAreaTravelTimes(void)
 			PAD(revreach->numlinks, sizeof(long)) * sizeof(unsigned short);
 	} //end for
 	//allocate memory for the area travel times
-	ptr = (char *) GetClearedMemory(size);
+	ptr = (char *) GetClearedMapMemory(size);
 	aasworld.areatraveltimes = (unsigned short ***) ptr;
 	ptr += aasworld.numareas * sizeof(unsigned short **);
 	//calcluate the travel times for all the areas
@@ -611,7 +662,7 @@ void AAS_InitPortalMaxTravelTimes(void)
 
 	if (aasworld.portalmaxtraveltimes) FreeMemory(aasworld.portalmaxtraveltimes);
 
-	aasworld.portalmaxtraveltimes = (int *) GetClearedMemory(aasworld.numportals * sizeof(int));
+	aasworld.portalmaxtraveltimes = (int *) GetClearedMapMemory(aasworld.numportals * sizeof(int));
 
 	for (i = 0; i < aasworld.numportals; i++)
 	{
@@ -710,6 +761,10 @@ int AAS_FreeOldestCache(void)
 		if (cache->type == CACHETYPE_AREA && aasworld.areasettings[cache->areanum].cluster < 0) {
 			continue;
 		}
+		// a routing worker may still be writing into it
+		if (AAS_RoutingCachePending(cache)) {
+			continue;
+		}
 		break;
 	}
 	if (cache) {
@@ -771,6 +826,7 @@ void AAS_FreeAllClusterAreaCache(void)
 
 	//free all cluster cache if existing
 	if (!aasworld.clusterareacache) return;
+	AAS_FinishRoutingJobs();
 	//free caches
 	for (i = 0; i < aasworld.numclusters; i++)
 	{
@@ -807,7 +863,7 @@ void AAS_InitClusterAreaCache(void)
 	} //end for
 	//two dimensional array with pointers for every cluster to routing cache
 	//for every area in that cluster
-	ptr = (char *) GetClearedMemory(
+	ptr = (char *) GetClearedMapMemory(
 				aasworld.numclusters * sizeof(aas_routingcache_t **) +
 				size * sizeof(aas_routingcache_t *));
 	aasworld.clusterareacache = (aas_routingcache_t ***) ptr;
@@ -853,7 +909,7 @@ void AAS_FreeAllPortalCache(void)
 void AAS_InitPortalCache(void)
 {
 	//
-	aasworld.portalcache = (aas_routingcache_t **) GetClearedMemory(
+	aasworld.portalcache = (aas_routingcache_t **) GetClearedMapMemory(
 								aasworld.numareas * sizeof(aas_routingcache_t *));
 } //end of the function AAS_InitPortalCache
 //===========================================================================
@@ -878,12 +934,12 @@ void AAS_InitRoutingUpdate(void)
 		} //end if
 	} //end for
 	//allocate memory for the routing update fields
-	aasworld.areaupdate = (aas_routingupdate_t *) GetClearedMemory(
+	aasworld.areaupdate = (aas_routingupdate_t *) GetClearedMapMemory(
 									maxreachabilityareas * sizeof(aas_routingupdate_t));
 	//
 	if (aasworld.portalupdate) FreeMemory(aasworld.portalupdate);
 	//allocate memory for the portal update fields
-	aasworld.portalupdate = (aas_routingupdate_t *) GetClearedMemory(
+	aasworld.portalupdate = (aas_routingupdate_t *) GetClearedMapMemory(
 									(aasworld.numportals+1) * sizeof(aas_routingupdate_t));
 } //end of the function AAS_InitRoutingUpdate
 //===========================================================================
@@ -921,8 +977,8 @@ void AAS_CreateAllRoutingCache(void)
 //===========================================================================
 
 //the route cache header
-//this header is followed by numportalcache + numareacache aas_routingcache_t
-//structures that store routing cache
+//this header is followed by numportalcache + numareacache routecacherecord_t
+//records, each followed by the travel times and reachabilities of the cache
 typedef struct routecacheheader_s
 {
 	int ident;
@@ -931,42 +987,157 @@ typedef struct routecacheheader_s
 	int numclusters;
 	int areacrc;
 	int clustercrc;
+	int settingscrc;
 	int numportalcache;
 	int numareacache;
+	int datasize;
 } routecacheheader_t;
 
+typedef struct routecacherecord_s
+{
+	int type;
+	int cluster;
+	int areanum;
+	vec3_t origin;
+	float starttraveltime;
+	int travelflags;
+	int numtraveltimes;
+} routecacherecord_t;
+
 #define RCID						(('C'<<24)+('R'<<16)+('E'<<8)+'M')
-#define RCVERSION					2
+#define RCVERSION					3
+
+//the route cache index keeps track of the route cache files of all maps
+//so the least recently played maps can be evicted when over budget
+typedef struct routecacheindexentry_s
+{
+	char mapname[MAX_QPATH];
+	int size;
+	int stamp;
+} routecacheindexentry_t;
+
+typedef struct routecacheindex_s
+{
+	int ident;
+	int version;
+	int numentries;
+	routecacheindexentry_t entries[1];
+} routecacheindex_t;
 
+#define RCINDEXID					(('X'<<24)+('I'<<16)+('C'<<8)+'R')
+#define RCINDEXVERSION				1
+#define RCINDEXFILE					"maps/routecache.idx"
+#define MAX_RCINDEXENTRIES			256
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteCacheNumTravelTimes(aas_routingcache_t *cache)
+{
+	return (cache->size - sizeof(aas_routingcache_t)) / (sizeof(unsigned short int) + sizeof(unsigned char));
+} //end of the function AAS_RouteCacheNumTravelTimes
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static int AAS_RouteCacheRecordSize(aas_routingcache_t *cache)
+{
+	int numtraveltimes;
+
+	numtraveltimes = AAS_RouteCacheNumTravelTimes(cache);
+	return sizeof(routecacherecord_t) + numtraveltimes * (sizeof(unsigned short int) + sizeof(unsigned char));
+} //end of the function AAS_RouteCacheRecordSize
+//===========================================================================
+// fills in the fields of the header that identify the loaded AAS data
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RouteCacheChecksums(routecacheheader_t *header)
+{
+	header->numareas = aasworld.numareas;
+	header->numclusters = aasworld.numclusters;
+	header->areacrc = CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas );
+	header->clustercrc = CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters );
+	//the area contents include the disabled flag, caches built with
+	//disabled areas must not be used once the areas are enabled again
+	header->settingscrc = CRC_ProcessString( (unsigned char *)aasworld.areasettings, sizeof(aas_areasettings_t) * aasworld.numareas );
+} //end of the function AAS_RouteCacheChecksums
+//===========================================================================
+// serializes the most recently used caches up to the given number of bytes,
+// the caches are stored from oldest to newest so reading them back in
+// restores the LRU order
+//
+// Parameter:			-
+// Returns:				buffer allocated with GetMemory
+// Changes Globals:		-
+//===========================================================================
+static byte *AAS_SerializeRouteCache(int budget, int *size)
+{
+	int datasize, recordsize;
+	aas_routingcache_t *cache, *oldest;
+	routecacheheader_t *header;
+	routecacherecord_t record;
+	byte *buf, *ptr;
+
+	datasize = 0;
+	oldest = NULL;
+	for (cache = aasworld.newestcache; cache; cache = cache->time_prev)
+	{
+		recordsize = AAS_RouteCacheRecordSize(cache);
+		if (datasize + recordsize > budget) break;
+		datasize += recordsize;
+		oldest = cache;
+	} //end for
+	buf = (byte *) GetClearedMemory(sizeof(routecacheheader_t) + datasize);
+	header = (routecacheheader_t *) buf;
+	header->ident = RCID;
+	header->version = RCVERSION;
+	AAS_RouteCacheChecksums(header);
+	header->datasize = datasize;
+	ptr = buf + sizeof(routecacheheader_t);
+	for (cache = oldest; cache; cache = cache->time_next)
+	{
+		record.type = cache->type;
+		record.cluster = cache->cluster;
+		record.areanum = cache->areanum;
+		VectorCopy(cache->origin, record.origin);
+		record.starttraveltime = cache->starttraveltime;
+		record.travelflags = cache->travelflags;
+		record.numtraveltimes = AAS_RouteCacheNumTravelTimes(cache);
+		Com_Memcpy(ptr, &record, sizeof(record));
+		ptr += sizeof(record);
+		Com_Memcpy(ptr, cache->traveltimes, record.numtraveltimes * sizeof(unsigned short int));
+		ptr += record.numtraveltimes * sizeof(unsigned short int);
+		Com_Memcpy(ptr, cache->reachabilities, record.numtraveltimes * sizeof(unsigned char));
+		ptr += record.numtraveltimes * sizeof(unsigned char);
+		if (cache->type == CACHETYPE_PORTAL) header->numportalcache++;
+		else header->numareacache++;
+	} //end for
+	*size = sizeof(routecacheheader_t) + datasize;
+	return buf;
+} //end of the function AAS_SerializeRouteCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void AAS_WriteRouteCache(void)
 {
-	int i, j, numportalcache, numareacache, totalsize;
-	aas_routingcache_t *cache;
-	aas_cluster_t *cluster;
+	int size;
 	fileHandle_t fp;
 	char filename[MAX_QPATH];
-	routecacheheader_t routecacheheader;
+	byte *buf;
 
-	numportalcache = 0;
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
-		{
-			numportalcache++;
-		} //end for
-	} //end for
-	numareacache = 0;
-	for (i = 0; i < aasworld.numclusters; i++)
-	{
-		cluster = &aasworld.clusters[i];
-		for (j = 0; j < cluster->numareas; j++)
-		{
-			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
-			{
-				numareacache++;
-			} //end for
-		} //end for
-	} //end for
+	//all the cache has to be filled in before writing it out
+	AAS_FinishRoutingJobs();
 	// open the file for writing
 	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", aasworld.mapname);
 	botimport.FS_FOpenFile( filename, &fp, FS_WRITE );
@@ -975,80 +1146,173 @@ void AAS_WriteRouteCache(void)
 		AAS_Error("Unable to open file: %s\n", filename);
 		return;
 	} //end if
-	//create the header
-	routecacheheader.ident = RCID;
-	routecacheheader.version = RCVERSION;
-	routecacheheader.numareas = aasworld.numareas;
-	routecacheheader.numclusters = aasworld.numclusters;
-	routecacheheader.areacrc = CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas );
-	routecacheheader.clustercrc = CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters );
-	routecacheheader.numportalcache = numportalcache;
-	routecacheheader.numareacache = numareacache;
-	//write the header
-	botimport.FS_Write(&routecacheheader, sizeof(routecacheheader_t), fp);
-	//
-	totalsize = 0;
-	//write all the cache
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		for (cache = aasworld.portalcache[i]; cache; cache = cache->next)
+	//a record is never larger than the cache itself so everything fits
+	buf = AAS_SerializeRouteCache(routingcachesize, &size);
+	botimport.FS_Write(buf, size, fp);
+	botimport.FS_FCloseFile(fp);
+	FreeMemory(buf);
+	routingcachechanged = qfalse;
+	botimport.Print(PRT_MESSAGE, "\nroute cache written to %s\n", filename);
+	botimport.Print(PRT_MESSAGE, "written %d bytes of routing cache\n", size);
+} //end of the function AAS_WriteRouteCache
+//===========================================================================
+// the botlib can't remove files, so this leaves an empty file behind
+// that fails validation when it's read
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_EmptyRouteCacheFile(const char *mapname)
+{
+	fileHandle_t fp;
+	char filename[MAX_QPATH];
+
+	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", mapname);
+	botimport.FS_FOpenFile(filename, &fp, FS_WRITE);
+	if (fp) botimport.FS_FCloseFile(fp);
+} //end of the function AAS_EmptyRouteCacheFile
+//===========================================================================
+// updates the route cache index with the file written for the current map
+// and empties the files of the least recently played maps until all files
+// fit in the budget
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_UpdateRouteCacheIndex(int size, int budget)
+{
+	int i, len, total, oldest, stamp, indexsize;
+	fileHandle_t fp;
+	routecacheindex_t *index;
+	routecacheindexentry_t *entry;
+
+	indexsize = sizeof(routecacheindex_t) + (MAX_RCINDEXENTRIES - 1) * sizeof(routecacheindexentry_t);
+	index = (routecacheindex_t *) GetClearedMemory(indexsize);
+	len = botimport.FS_FOpenFile(RCINDEXFILE, &fp, FS_READ);
+	if (fp)
+	{
+		if (len <= indexsize) botimport.FS_Read(index, len, fp);
+		botimport.FS_FCloseFile(fp);
+		if (index->ident != RCINDEXID || index->version != RCINDEXVERSION ||
+			index->numentries < 0 || index->numentries > MAX_RCINDEXENTRIES ||
+			len != (int) (sizeof(routecacheindex_t) + (index->numentries - 1) * sizeof(routecacheindexentry_t)))
 		{
-			botimport.FS_Write(cache, cache->size, fp);
-			totalsize += cache->size;
-		} //end for
+			Com_Memset(index, 0, indexsize);
+		} //end if
+	} //end if
+	index->ident = RCINDEXID;
+	index->version = RCINDEXVERSION;
+	//find the entry of the current map
+	entry = NULL;
+	stamp = 0;
+	for (i = 0; i < index->numentries; i++)
+	{
+		if (index->entries[i].stamp > stamp) stamp = index->entries[i].stamp;
+		if (!Q_stricmp(index->entries[i].mapname, aasworld.mapname)) entry = &index->entries[i];
 	} //end for
-	for (i = 0; i < aasworld.numclusters; i++)
+	if (!entry)
 	{
-		cluster = &aasworld.clusters[i];
-		for (j = 0; j < cluster->numareas; j++)
+		if (index->numentries >= MAX_RCINDEXENTRIES)
 		{
-			for (cache = aasworld.clusterareacache[i][j]; cache; cache = cache->next)
+			//make room by dropping the oldest entry from the index
+			oldest = 0;
+			for (i = 1; i < index->numentries; i++)
 			{
-				botimport.FS_Write(cache, cache->size, fp);
-				totalsize += cache->size;
+				if (index->entries[i].stamp < index->entries[oldest].stamp) oldest = i;
 			} //end for
+			//the file would no longer be counted against the budget
+			AAS_EmptyRouteCacheFile(index->entries[oldest].mapname);
+			index->entries[oldest] = index->entries[--index->numentries];
+		} //end if
+		entry = &index->entries[index->numentries++];
+		Q_strncpyz(entry->mapname, aasworld.mapname, sizeof(entry->mapname));
+	} //end if
+	if (size >= 0) entry->size = size;
+	entry->stamp = stamp + 1;
+	//evict the least recently played maps until within budget
+	while (1)
+	{
+		total = 0;
+		oldest = -1;
+		for (i = 0; i < index->numentries; i++)
+		{
+			total += index->entries[i].size;
+			if (&index->entries[i] == entry) continue;
+			if (oldest < 0 || index->entries[i].stamp < index->entries[oldest].stamp) oldest = i;
 		} //end for
-	} //end for
-	// write the visareas
-	/*
-	for (i = 0; i < aasworld.numareas; i++)
+		if (total <= budget || oldest < 0) break;
+		AAS_EmptyRouteCacheFile(index->entries[oldest].mapname);
+		if (entry == &index->entries[index->numentries - 1]) entry = &index->entries[oldest];
+		index->entries[oldest] = index->entries[--index->numentries];
+	} //end while
+	botimport.FS_FOpenFile(RCINDEXFILE, &fp, FS_WRITE);
+	if (fp)
 	{
-		if (!aasworld.areavisibility[i]) {
-			size = 0;
-			botimport.FS_Write(&size, sizeof(int), fp);
-			continue;
-		}
-		AAS_DecompressVis( aasworld.areavisibility[i], aasworld.numareas, aasworld.decompressedvis );
-		size = AAS_CompressVis( aasworld.decompressedvis, aasworld.numareas, aasworld.decompressedvis );
-		botimport.FS_Write(&size, sizeof(int), fp);
-		botimport.FS_Write(aasworld.decompressedvis, size, fp);
-	}
-	*/
-	//
-	botimport.FS_FCloseFile(fp);
-	botimport.Print(PRT_MESSAGE, "\nroute cache written to %s\n", filename);
-	botimport.Print(PRT_MESSAGE, "written %d bytes of routing cache\n", totalsize);
-} //end of the function AAS_WriteRouteCache
+		botimport.FS_Write(index, sizeof(routecacheindex_t) + (index->numentries - 1) * sizeof(routecacheindexentry_t), fp);
+		botimport.FS_FCloseFile(fp);
+	} //end if
+	FreeMemory(index);
+} //end of the function AAS_UpdateRouteCacheIndex
 //===========================================================================
+// writes the routing caches of the current map out on a background
+// thread so the next time the map is loaded routing is fast right away
 //
 // Parameter:			-
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
+static void AAS_SaveRouteCache(void)
 {
-	int size;
-	aas_routingcache_t *cache;
+	int size, budget;
+	fileHandle_t fp;
+	char filename[MAX_QPATH];
+	byte *buf;
 
-	botimport.FS_Read(&size, sizeof(size), fp);
-	cache = (aas_routingcache_t *) GetMemory(size);
-	cache->size = size;
-	botimport.FS_Read((unsigned char *)cache + sizeof(size), size - sizeof(size), fp);
-	cache->reachabilities = (unsigned char *) cache + sizeof(aas_routingcache_t) - sizeof(unsigned short) +
-		(size - sizeof(aas_routingcache_t) + sizeof(unsigned short)) / 3 * 2;
-	return cache;
-} //end of the function AAS_ReadCache
+	if (!aasworld.loaded || !aasworld.portalcache || !aasworld.clusterareacache) return;
+	if (!(int) LibVarValue("autoroutingcache", "1")) return;
+	budget = 1024 * (int) LibVarValue("max_routingcachefiles", "65536");
+	//only touch the index when nothing new was computed
+	if (!routingcachechanged || !aasworld.newestcache)
+	{
+		AAS_UpdateRouteCacheIndex(-1, budget);
+		return;
+	} //end if
+	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", aasworld.mapname);
+	fp = botimport.FS_FOpenFileWriteAsync(filename, qtrue);
+	if (!fp) return;
+	buf = AAS_SerializeRouteCache(budget < max_routingcachesize ? budget : max_routingcachesize, &size);
+	botimport.FS_Write(buf, size, fp);
+	botimport.FS_FCloseFile(fp);
+	FreeMemory(buf);
+	routingcachechanged = qfalse;
+	AAS_UpdateRouteCacheIndex(size, budget);
+} //end of the function AAS_SaveRouteCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
 //===========================================================================
+static bool AAS_ValidRouteCacheRecord(routecacherecord_t *record)
+{
+	int clusterareanum;
+
+	if (record->areanum <= 0 || record->areanum >= aasworld.numareas) return false;
+	if (record->type == CACHETYPE_PORTAL)
+	{
+		return record->numtraveltimes == aasworld.numportals;
+	} //end if
+	if (record->type != CACHETYPE_AREA) return false;
+	if (record->cluster <= 0 || record->cluster >= aasworld.numclusters) return false;
+	if (record->numtraveltimes != aasworld.clusters[record->cluster].numreachabilityareas) return false;
+	clusterareanum = AAS_ClusterAreaNum(record->cluster, record->areanum);
+	return clusterareanum >= 0 && clusterareanum < aasworld.clusters[record->cluster].numareas;
+} //end of the function AAS_ValidRouteCacheRecord
+//===========================================================================
+// the file is read with a single read and validated against the loaded
+// AAS data before any of the caches are used
 //
 // Parameter:			-
 // Returns:				-
@@ -1056,87 +1320,84 @@ aas_routingcache_t *AAS_ReadCache(fileHandle_t fp)
 //===========================================================================
 int AAS_ReadRouteCache(void)
 {
-	int i, clusterareanum;//, size;
+	int len, clusterareanum, numcaches, tablesize;
 	fileHandle_t fp;
 	char filename[MAX_QPATH];
-	routecacheheader_t routecacheheader;
-	aas_routingcache_t *cache;
+	routecacheheader_t current, *header;
+	routecacherecord_t record;
+	aas_routingcache_t *cache, **head;
+	byte *buf, *ptr, *end;
 
+	routingcachechanged = qfalse;
 	Com_sprintf(filename, MAX_QPATH, "maps/%s.rcd", aasworld.mapname);
-	botimport.FS_FOpenFile( filename, &fp, FS_READ );
+	len = botimport.FS_FOpenFile( filename, &fp, FS_READ );
 	if (!fp)
 	{
 		return qfalse;
 	} //end if
-	botimport.FS_Read(&routecacheheader, sizeof(routecacheheader_t), fp );
-	if (routecacheheader.ident != RCID)
-	{
-		AAS_Error("%s is not a route cache dump\n", filename);
-		return qfalse;
-	} //end if
-	if (routecacheheader.version != RCVERSION)
-	{
-		AAS_Error("route cache dump has wrong version %d, should be %d", routecacheheader.version, RCVERSION);
-		return qfalse;
-	} //end if
-	if (routecacheheader.numareas != aasworld.numareas)
-	{
-		//AAS_Error("route cache dump has wrong number of areas\n");
-		return qfalse;
-	} //end if
-	if (routecacheheader.numclusters != aasworld.numclusters)
-	{
-		//AAS_Error("route cache dump has wrong number of clusters\n");
-		return qfalse;
-	} //end if
-	if (routecacheheader.areacrc !=
-		CRC_ProcessString( (unsigned char *)aasworld.areas, sizeof(aas_area_t) * aasworld.numareas ))
+	if (len < (int) sizeof(routecacheheader_t))
 	{
-		//AAS_Error("route cache dump area CRC incorrect\n");
+		botimport.FS_FCloseFile(fp);
 		return qfalse;
 	} //end if
-	if (routecacheheader.clustercrc !=
-		CRC_ProcessString( (unsigned char *)aasworld.clusters, sizeof(aas_cluster_t) * aasworld.numclusters ))
-	{
-		//AAS_Error("route cache dump cluster CRC incorrect\n");
+	buf = (byte *) GetMemory(len);
+	botimport.FS_Read(buf, len, fp);
+	botimport.FS_FCloseFile(fp);
+	header = (routecacheheader_t *) buf;
+	AAS_RouteCacheChecksums(&current);
+	if (header->ident != RCID || header->version != RCVERSION ||
+		header->datasize != len - (int) sizeof(routecacheheader_t) ||
+		header->numareas != current.numareas || header->numclusters != current.numclusters ||
+		header->areacrc != current.areacrc || header->clustercrc != current.clustercrc ||
+		header->settingscrc != current.settingscrc)
+	{
+		//stale or from an older version, it's rebuilt at the end of the map
+		FreeMemory(buf);
 		return qfalse;
 	} //end if
-	//read all the portal cache
-	for (i = 0; i < routecacheheader.numportalcache; i++)
-	{
-		cache = AAS_ReadCache(fp);
-		cache->next = aasworld.portalcache[cache->areanum];
-		cache->prev = NULL;
-		if (aasworld.portalcache[cache->areanum])
-			aasworld.portalcache[cache->areanum]->prev = cache;
-		aasworld.portalcache[cache->areanum] = cache;
-	} //end for
-	//read all the cluster area cache
-	for (i = 0; i < routecacheheader.numareacache; i++)
-	{
-		cache = AAS_ReadCache(fp);
-		clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
-		cache->next = aasworld.clusterareacache[cache->cluster][clusterareanum];
+	numcaches = 0;
+	ptr = buf + sizeof(routecacheheader_t);
+	end = buf + len;
+	while (ptr + sizeof(record) <= end)
+	{
+		Com_Memcpy(&record, ptr, sizeof(record));
+		ptr += sizeof(record);
+		if (!AAS_ValidRouteCacheRecord(&record)) break;
+		tablesize = record.numtraveltimes * (sizeof(unsigned short int) + sizeof(unsigned char));
+		if (ptr + tablesize > end) break;
+		if (routingcachesize + (int) sizeof(aas_routingcache_t) + tablesize > max_routingcachesize) break;
+		cache = AAS_AllocRoutingCache(record.numtraveltimes);
+		cache->type = record.type;
+		cache->cluster = record.cluster;
+		cache->areanum = record.areanum;
+		VectorCopy(record.origin, cache->origin);
+		cache->starttraveltime = record.starttraveltime;
+		cache->travelflags = record.travelflags;
+		cache->time = AAS_RoutingTime();
+		Com_Memcpy(cache->traveltimes, ptr, record.numtraveltimes * sizeof(unsigned short int));
+		ptr += record.numtraveltimes * sizeof(unsigned short int);
+		Com_Memcpy(cache->reachabilities, ptr, record.numtraveltimes * sizeof(unsigned char));
+		ptr += record.numtraveltimes * sizeof(unsigned char);
+		if (cache->type == CACHETYPE_PORTAL)
+		{
+			head = &aasworld.portalcache[cache->areanum];
+		} //end if
+		else
+		{
+			clusterareanum = AAS_ClusterAreaNum(cache->cluster, cache->areanum);
+			head = &aasworld.clusterareacache[cache->cluster][clusterareanum];
+		} //end else
+		cache->next = *head;
 		cache->prev = NULL;
-		if (aasworld.clusterareacache[cache->cluster][clusterareanum])
-			aasworld.clusterareacache[cache->cluster][clusterareanum]->prev = cache;
-		aasworld.clusterareacache[cache->cluster][clusterareanum] = cache;
-	} //end for
-	// read the visareas
-	/*
-	aasworld.areavisibility = (byte **) GetClearedMemory(aasworld.numareas * sizeof(byte *));
-	aasworld.decompressedvis = (byte *) GetClearedMemory(aasworld.numareas * sizeof(byte));
-	for (i = 0; i < aasworld.numareas; i++)
-	{
-		botimport.FS_Read(&size, sizeof(size), fp );
-		if (size) {
-			aasworld.areavisibility[i] = (byte *) GetMemory(size);
-			botimport.FS_Read(aasworld.areavisibility[i], size, fp );
-		}
-	}
-	*/
-	//
-	botimport.FS_FCloseFile(fp);
+		if (*head) (*head)->prev = cache;
+		*head = cache;
+		AAS_LinkCache(cache);
+		numcaches++;
+	} //end while
+	FreeMemory(buf);
+	//the caches just read are already in the file
+	routingcachechanged = qfalse;
+	botimport.Print(PRT_MESSAGE, "%d routing caches read from %s\n", numcaches, filename);
 	return qtrue;
 } //end of the function AAS_ReadRouteCache
 //===========================================================================
@@ -1160,9 +1421,9 @@ void AAS_InitReachabilityAreas(void)
 		FreeMemory(aasworld.reachabilityareaindex);
 
 	aasworld.reachabilityareas = (aas_reachabilityareas_t *)
-				GetClearedMemory(aasworld.reachabilitysize * sizeof(aas_reachabilityareas_t));
+				GetClearedMapMemory(aasworld.reachabilitysize * sizeof(aas_reachabilityareas_t));
 	aasworld.reachabilityareaindex = (int *)
-				GetClearedMemory(aasworld.reachabilitysize * MAX_REACHABILITYPASSAREAS * sizeof(int));
+				GetClearedMapMemory(aasworld.reachabilitysize * MAX_REACHABILITYPASSAREAS * sizeof(int));
 	numreachareas = 0;
 	for (i = 0; i < aasworld.reachabilitysize; i++)
 	{
@@ -1214,6 +1475,273 @@ void AAS_InitReachabilityAreas(void)
 	} //end for
 } //end of the function AAS_InitReachabilityAreas
 //===========================================================================
+// fills in queued area routing caches until told to quit
+//
+// Parameter:			areaupdate		: routing update fields owned by this worker
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_RoutingWorker(aas_routingupdate_t *areaupdate)
+{
+	aas_routingcache_t *cache;
+	std::unique_lock<std::mutex> lock(routingmutex);
+
+	while (1)
+	{
+		routingjobready.wait(lock, [] { return routingworkersquit || !routingjobs.empty(); });
+		if (routingjobs.empty()) break;
+		cache = routingjobs.front();
+		routingjobs.pop_front();
+		lock.unlock();
+		AAS_UpdateAreaRoutingCache(cache, areaupdate);
+		lock.lock();
+		cache->pending = qfalse;
+		numpendingcaches--;
+		routingjobdone.notify_all();
+	} //end while
+} //end of the function AAS_RoutingWorker
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_StartRoutingWorkers(void)
+{
+	int i, numworkers, maxreachabilityareas;
+
+	numworkers = (int) LibVarValue("routingthreads", "2");
+	if (numworkers <= 0) return;
+	if (numworkers > 8) numworkers = 8;
+	//
+	maxreachabilityareas = 0;
+	for (i = 0; i < aasworld.numclusters; i++)
+	{
+		if (aasworld.clusters[i].numreachabilityareas > maxreachabilityareas)
+		{
+			maxreachabilityareas = aasworld.clusters[i].numreachabilityareas;
+		} //end if
+	} //end for
+	//
+	routingworkersquit = false;
+	for (i = 0; i < numworkers; i++)
+	{
+		//allocated here, the memory functions are not thread safe
+		aas_routingupdate_t *areaupdate = (aas_routingupdate_t *) GetClearedMemory(
+									maxreachabilityareas * sizeof(aas_routingupdate_t));
+		routingworkerupdates.push_back(areaupdate);
+		routingworkers.push_back(std::thread(AAS_RoutingWorker, areaupdate));
+	} //end for
+} //end of the function AAS_StartRoutingWorkers
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_StopRoutingWorkers(void)
+{
+	size_t i;
+
+	if (routingworkers.empty()) return;
+	//
+	{
+		std::lock_guard<std::mutex> lock(routingmutex);
+		routingworkersquit = true;
+	}
+	routingjobready.notify_all();
+	//the workers drain the queue before quitting
+	for (i = 0; i < routingworkers.size(); i++)
+	{
+		routingworkers[i].join();
+	} //end for
+	for (i = 0; i < routingworkerupdates.size(); i++)
+	{
+		FreeMemory(routingworkerupdates[i]);
+	} //end for
+	routingworkers.clear();
+	routingworkerupdates.clear();
+} //end of the function AAS_StopRoutingWorkers
+//===========================================================================
+// makes sure no routing worker is touching any cache or the AAS world
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_FinishRoutingJobs(void)
+{
+	aas_routingcache_t *cache;
+
+	if (!numpendingcaches.load()) return;
+	//
+	std::unique_lock<std::mutex> lock(routingmutex);
+	//jobs no worker picked up yet are done right here
+	while (!routingjobs.empty())
+	{
+		cache = routingjobs.front();
+		routingjobs.pop_front();
+		lock.unlock();
+		AAS_UpdateAreaRoutingCache(cache, aasworld.areaupdate);
+		lock.lock();
+		cache->pending = qfalse;
+		numpendingcaches--;
+	} //end while
+	routingjobdone.wait(lock, [] { return numpendingcaches.load() == 0; });
+} //end of the function AAS_FinishRoutingJobs
+//===========================================================================
+// waits until the given cache is filled in, doing it right away if no
+// worker has started on it yet
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_WaitForRoutingCache(aas_routingcache_t *cache)
+{
+	std::deque<aas_routingcache_t *>::iterator it;
+	std::unique_lock<std::mutex> lock(routingmutex);
+
+	if (!cache->pending) return;
+	for (it = routingjobs.begin(); it != routingjobs.end(); ++it)
+	{
+		if (*it == cache) break;
+	} //end for
+	if (it != routingjobs.end())
+	{
+		routingjobs.erase(it);
+		lock.unlock();
+		AAS_UpdateAreaRoutingCache(cache, aasworld.areaupdate);
+		lock.lock();
+		cache->pending = qfalse;
+		numpendingcaches--;
+		return;
+	} //end if
+	routingjobdone.wait(lock, [cache] { return !cache->pending; });
+} //end of the function AAS_WaitForRoutingCache
+//===========================================================================
+// queues an area routing cache for the routing workers if it doesn't exist yet
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrefetchAreaRoutingCache(int clusternum, int areanum, int travelflags)
+{
+	int clusterareanum;
+	aas_routingcache_t *cache, *clustercache;
+
+	if (clusternum <= 0 || clusternum >= aasworld.numclusters) return;
+	clusterareanum = AAS_ClusterAreaNum(clusternum, areanum);
+	if (clusterareanum >= aasworld.clusters[clusternum].numreachabilityareas) return;
+	//
+	clustercache = aasworld.clusterareacache[clusternum][clusterareanum];
+	for (cache = clustercache; cache; cache = cache->next)
+	{
+		if (cache->travelflags == travelflags) return;
+	} //end for
+	//
+	cache = AAS_AllocRoutingCache(aasworld.clusters[clusternum].numreachabilityareas);
+	cache->cluster = clusternum;
+	cache->areanum = areanum;
+	VectorCopy(aasworld.areas[areanum].center, cache->origin);
+	cache->starttraveltime = 1;
+	cache->travelflags = travelflags;
+	cache->prev = NULL;
+	cache->next = clustercache;
+	if (clustercache) clustercache->prev = cache;
+	aasworld.clusterareacache[clusternum][clusterareanum] = cache;
+	cache->time = AAS_RoutingTime();
+	cache->type = CACHETYPE_AREA;
+	AAS_LinkCache(cache);
+	//
+#ifdef ROUTING_DEBUG
+	numareacacheupdates++;
+#endif //ROUTING_DEBUG
+	numprefetchedcaches++;
+	//without workers the cache is filled in right away
+	if (routingworkers.empty())
+	{
+		AAS_UpdateAreaRoutingCache(cache, aasworld.areaupdate);
+		return;
+	} //end if
+	{
+		std::lock_guard<std::mutex> lock(routingmutex);
+		cache->pending = qtrue;
+		numpendingcaches++;
+		routingjobs.push_back(cache);
+	}
+	routingjobready.notify_one();
+} //end of the function AAS_PrefetchAreaRoutingCache
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void AAS_PrefetchGoalArea(int areanum, int travelflags)
+{
+	int clusternum;
+
+	if (areanum <= 0 || areanum >= aasworld.numareas) return;
+	clusternum = aasworld.areasettings[areanum].cluster;
+	if (clusternum > 0)
+	{
+		AAS_PrefetchAreaRoutingCache(clusternum, areanum, travelflags);
+	} //end if
+	else
+	{
+		AAS_PrefetchAreaRoutingCache(aasworld.portals[-clusternum].frontcluster, areanum, travelflags);
+		AAS_PrefetchAreaRoutingCache(aasworld.portals[-clusternum].backcluster, areanum, travelflags);
+	} //end else
+} //end of the function AAS_PrefetchGoalArea
+//===========================================================================
+// queue the routing caches bots are going to ask for first: the caches
+// towards every cluster portal, which all inter cluster routing goes
+// through, and the caches towards items, flags and spawn points
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void AAS_PrefetchRoutingCaches(void)
+{
+	int i, ent, areanum;
+	char classname[MAX_EPAIRKEY];
+	vec3_t origin, goalorigin;
+	vec3_t itemmins = {-15, -15, -15}, itemmaxs = {15, 15, 15};
+	vec3_t playermins = {-15, -15, -24}, playermaxs = {15, 15, 32};
+
+	numprefetchedcaches = 0;
+	for (i = 1; i < aasworld.numportals; i++)
+	{
+		AAS_PrefetchGoalArea(aasworld.portals[i].areanum, TFL_DEFAULT);
+	} //end for
+	//
+	for (ent = AAS_NextBSPEntity(0); ent; ent = AAS_NextBSPEntity(ent))
+	{
+		//leave room for the caches created on demand
+		if (routingcachesize > max_routingcachesize / 2) break;
+		if (!AAS_ValueForBSPEpairKey(ent, "classname", classname, MAX_EPAIRKEY)) continue;
+		if (!AAS_VectorForBSPEpairKey(ent, "origin", origin)) continue;
+		//
+		if (!Q_strncmp(classname, "info_player_", 12) || (!Q_strncmp(classname, "team_CTF_", 9) && strstr(classname, "player")))
+		{
+			areanum = AAS_BestReachableArea(origin, playermins, playermaxs, goalorigin);
+		} //end if
+		else if (!Q_strncmp(classname, "item_", 5) || !Q_strncmp(classname, "weapon_", 7) ||
+					!Q_strncmp(classname, "ammo_", 5) || !Q_strncmp(classname, "team_CTF_", 9))
+		{
+			areanum = AAS_BestReachableArea(origin, itemmins, itemmaxs, goalorigin);
+		} //end else if
+		else
+		{
+			continue;
+		} //end else
+		AAS_PrefetchGoalArea(areanum, TFL_DEFAULT);
+	} //end for
+} //end of the function AAS_PrefetchRoutingCaches
+//===========================================================================
 //
 // Parameter:			-
 // Returns:				-
@@ -1248,6 +1776,9 @@ void AAS_InitRouting(void)
 	max_routingcachesize = 1024 * (int) LibVarValue("max_routingcache", "4096");
 	// read any routing cache if available
 	AAS_ReadRouteCache();
+	//compute the caches bots will need first in the background
+	AAS_StartRoutingWorkers();
+	AAS_PrefetchRoutingCaches();
 } //end of the function AAS_InitRouting
 //===========================================================================
 //
@@ -1257,6 +1788,10 @@ void AAS_InitRouting(void)
 //===========================================================================
 void AAS_FreeRoutingCaches(void)
 {
+	// let the routing workers finish before freeing what they use
+	AAS_StopRoutingWorkers();
+	// write the caches out so they can be used the next time the map is loaded
+	AAS_SaveRouteCache();
 	// free all the existing cluster area cache
 	AAS_FreeAllClusterAreaCache();
 	// free all the existing portal cache
@@ -1287,12 +1822,15 @@ void AAS_FreeRoutingCaches(void)
 } //end of the function AAS_FreeRoutingCaches
 //===========================================================================
 // update the given routing cache
+// called from the routing workers as well, so only touches the cache
+// and the given routing update fields
 //
 // Parameter:			areacache		: routing cache to update
+//						areaupdate		: routing update fields to use
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
-void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
+void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache, aas_routingupdate_t *areaupdate)
 {
 	int i, nextareanum, cluster, badtravelflags, clusterareanum, linknum;
 	int numreachabilityareas;
@@ -1302,13 +1840,8 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	aas_reversedreachability_t *revreach;
 	aas_reversedlink_t *revlink;
 
-#ifdef ROUTING_DEBUG
-	numareacacheupdates++;
-#endif //ROUTING_DEBUG
 	//number of reachability areas within this cluster
 	numreachabilityareas = aasworld.clusters[areacache->cluster].numreachabilityareas;
-	//
-	aasworld.frameroutingupdates++;
 	//clear the routing update fields
 //	Com_Memset(aasworld.areaupdate, 0, aasworld.numareas * sizeof(aas_routingupdate_t));
 	//
@@ -1319,7 +1852,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 	//
 	Com_Memset(startareatraveltimes, 0, sizeof(startareatraveltimes));
 	//
-	curupdate = &aasworld.areaupdate[clusterareanum];
+	curupdate = &areaupdate[clusterareanum];
 	curupdate->areanum = areacache->areanum;
 	//VectorCopy(areacache->origin, curupdate->start);
 	curupdate->areatraveltimes = startareatraveltimes;
@@ -1375,7 +1908,7 @@ void AAS_UpdateAreaRoutingCache(aas_routingcache_t *areacache)
 			{
 				areacache->traveltimes[clusterareanum] = t;
 				areacache->reachabilities[clusterareanum] = linknum - aasworld.areasettings[nextareanum].firstreachablearea;
-				nextupdate = &aasworld.areaupdate[clusterareanum];
+				nextupdate = &areaupdate[clusterareanum];
 				nextupdate->areanum = nextareanum;
 				nextupdate->tmptraveltime = t;
 				//VectorCopy(reach->start, nextupdate->start);
@@ -1431,10 +1964,19 @@ aas_routingcache_t *AAS_GetAreaRoutingCache(int clusternum, int areanum, int tra
 		cache->next = clustercache;
 		if (clustercache) clustercache->prev = cache;
 		aasworld.clusterareacache[clusternum][clusterareanum] = cache;
-		AAS_UpdateAreaRoutingCache(cache);
+#ifdef ROUTING_DEBUG
+		numareacacheupdates++;
+#endif //ROUTING_DEBUG
+		aasworld.frameroutingupdates++;
+		AAS_UpdateAreaRoutingCache(cache, aasworld.areaupdate);
 	} //end if
 	else
 	{
+		//only block when a routing worker hasn't finished this exact cache
+		if (AAS_RoutingCachePending(cache))
+		{
+			AAS_WaitForRoutingCache(cache);
+		} //end if
 		AAS_UnlinkCache(cache);
 	} //end else
 	//the cache has been accessed
@@ -334,9 +334,250 @@ void DumpMemory(void)
 	totalmemorysize = 0;
 	allocatedmemory = 0;
 } //end of the function DumpMemory
+//===========================================================================
+// every block is tracked separately, so map memory is just regular memory
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetMapMemory(unsigned long size)
+{
+	return GetMemory(size);
+} //end of the function GetMapMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetClearedMapMemory(unsigned long size)
+{
+	return GetClearedMemory(size);
+} //end of the function GetClearedMapMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void FreeMapMemory(void)
+{
+} //end of the function FreeMapMemory
 
 #else
 
+/*
+
+  slabs:
+  small blocks are carved out of pages per size class instead of each
+  going through the zone, freed blocks go back on the free list of their
+  page and pages that become empty are given back to the zone.
+
+  map arena:
+  memory that lives as long as the map is allocated from big chunks and
+  all of it is released in one go with FreeMapMemory. FreeMemory on
+  arena memory does nothing.
+
+*/
+
+#define SLAB_ID				0x12345679l
+#define ARENA_ID			0x1234567al
+
+#define SLAB_PAGE_SIZE		(64 * 1024)
+#define MAX_SLAB_PAGES		4096
+#define NUM_SLAB_CLASSES	7
+#define MAPARENA_CHUNK_SIZE	(256 * 1024)
+#define SLAB_PAGE_SHIFT		12		//slab block sizes stay below 1 << SLAB_PAGE_SHIFT
+
+//every block starts with this header padded to qmax_align_t
+typedef struct memoryheader_s
+{
+	unsigned int id;
+	int info;		//size, for slab blocks the page number is stored above it
+} memoryheader_t;
+
+#define MEMORYHEADER_SIZE	sizeof(qmax_align_t)
+
+typedef struct slabpage_s
+{
+	byte *mem;
+	int sizeclass;
+	int numused;
+	int numcarved;				//blocks handed out at least once
+	byte *freeblocks;			//blocks freed again
+	struct slabpage_s *prev, *next;	//in the list of pages with free blocks
+} slabpage_t;
+
+typedef struct slabclass_s
+{
+	int blocksize;
+	int numblocks;				//blocks per page
+	slabpage_t *pages;			//pages with free blocks
+	int numpages;
+	int numused;
+	int peakused;
+	int requested;				//bytes asked for by the blocks in use
+} slabclass_t;
+
+typedef struct maparenachunk_s
+{
+	struct maparenachunk_s *next;
+	int size;
+	int used;
+} maparenachunk_t;
+
+static slabclass_t slabclasses[NUM_SLAB_CLASSES];
+static slabpage_t slabpages[MAX_SLAB_PAGES];
+static int freeslabpages[MAX_SLAB_PAGES];
+static int numfreeslabpages = -1;
+
+static maparenachunk_t *maparena;
+static int maparenaused, maparenasize, maparenapeak;
+
+static int zonememory, zonepeak, numzoneblocks;
+
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void InitSlabs(void)
+{
+	int i;
+
+	for (i = 0; i < NUM_SLAB_CLASSES; i++)
+	{
+		slabclasses[i].blocksize = 32 << i;
+		slabclasses[i].numblocks = SLAB_PAGE_SIZE / slabclasses[i].blocksize;
+	} //end for
+	for (i = 0; i < MAX_SLAB_PAGES; i++)
+	{
+		freeslabpages[i] = MAX_SLAB_PAGES - 1 - i;
+	} //end for
+	numfreeslabpages = MAX_SLAB_PAGES;
+} //end of the function InitSlabs
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void LinkSlabPage(slabclass_t *sc, slabpage_t *page)
+{
+	page->prev = NULL;
+	page->next = sc->pages;
+	if (sc->pages) sc->pages->prev = page;
+	sc->pages = page;
+} //end of the function LinkSlabPage
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void UnlinkSlabPage(slabclass_t *sc, slabpage_t *page)
+{
+	if (page->prev) page->prev->next = page->next;
+	else sc->pages = page->next;
+	if (page->next) page->next->prev = page->prev;
+	page->prev = page->next = NULL;
+} //end of the function UnlinkSlabPage
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				NULL if the size doesn't fit in a slab
+// Changes Globals:		-
+//===========================================================================
+static void *GetSlabMemory(unsigned long size)
+{
+	int i, pagenum;
+	unsigned long total;
+	slabclass_t *sc;
+	slabpage_t *page;
+	byte *block;
+	memoryheader_t *header;
+
+	if (numfreeslabpages < 0) InitSlabs();
+	total = size + MEMORYHEADER_SIZE;
+	for (i = 0; i < NUM_SLAB_CLASSES; i++)
+	{
+		if (total <= (unsigned long) slabclasses[i].blocksize) break;
+	} //end for
+	if (i >= NUM_SLAB_CLASSES) return NULL;
+	sc = &slabclasses[i];
+	page = sc->pages;
+	if (!page)
+	{
+		if (!numfreeslabpages) return NULL;
+		pagenum = freeslabpages[--numfreeslabpages];
+		page = &slabpages[pagenum];
+		page->mem = (byte *) botimport.GetMemory(SLAB_PAGE_SIZE);
+		if (!page->mem)
+		{
+			numfreeslabpages++;
+			return NULL;
+		} //end if
+		page->sizeclass = i;
+		page->numused = 0;
+		page->numcarved = 0;
+		page->freeblocks = NULL;
+		LinkSlabPage(sc, page);
+		sc->numpages++;
+	} //end if
+	if (page->freeblocks)
+	{
+		block = page->freeblocks;
+		page->freeblocks = *(byte **) (block + MEMORYHEADER_SIZE);
+	} //end if
+	else
+	{
+		block = page->mem + page->numcarved * sc->blocksize;
+		page->numcarved++;
+	} //end else
+	page->numused++;
+	if (page->numused >= sc->numblocks) UnlinkSlabPage(sc, page);
+	//
+	header = (memoryheader_t *) block;
+	header->id = SLAB_ID;
+	header->info = ((page - slabpages) << SLAB_PAGE_SHIFT) | size;
+	sc->numused++;
+	if (sc->numused > sc->peakused) sc->peakused = sc->numused;
+	sc->requested += size;
+	return block + MEMORYHEADER_SIZE;
+} //end of the function GetSlabMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+static void FreeSlabMemory(memoryheader_t *header)
+{
+	slabpage_t *page;
+	slabclass_t *sc;
+	byte *block;
+
+	page = &slabpages[header->info >> SLAB_PAGE_SHIFT];
+	sc = &slabclasses[page->sizeclass];
+	block = (byte *) header;
+	if (page->numused >= sc->numblocks) LinkSlabPage(sc, page);
+	*(byte **) (block + MEMORYHEADER_SIZE) = page->freeblocks;
+	page->freeblocks = block;
+	page->numused--;
+	sc->numused--;
+	sc->requested -= header->info & ((1 << SLAB_PAGE_SHIFT) - 1);
+	//give empty pages back unless it's the only page with free blocks
+	if (!page->numused && (page->prev || page->next))
+	{
+		UnlinkSlabPage(sc, page);
+		botimport.FreeMemory(page->mem);
+		page->mem = NULL;
+		freeslabpages[numfreeslabpages++] = page - slabpages;
+		sc->numpages--;
+	} //end if
+} //end of the function FreeSlabMemory
 //===========================================================================
 //
 // Parameter:			-
@@ -350,13 +591,19 @@ void *GetMemory(unsigned long size)
 #endif //MEMDEBUG
 {
 	void *ptr;
-	unsigned long int *memid;
+	memoryheader_t *header;
 
-	ptr = botimport.GetMemory(size + sizeof(qmax_align_t));
+	ptr = GetSlabMemory(size);
+	if (ptr) return ptr;
+	ptr = botimport.GetMemory(size + MEMORYHEADER_SIZE);
 	if (!ptr) return NULL;
-	memid = (unsigned long int *) ptr;
-	*memid = MEM_ID;
-	return (unsigned long int *) ((char *) ptr + sizeof(qmax_align_t));
+	header = (memoryheader_t *) ptr;
+	header->id = MEM_ID;
+	header->info = size;
+	zonememory += size;
+	if (zonememory > zonepeak) zonepeak = zonememory;
+	numzoneblocks++;
+	return (char *) ptr + MEMORYHEADER_SIZE;
 } //end of the function GetMemory
 //===========================================================================
 //
@@ -392,13 +639,14 @@ void *GetHunkMemory(unsigned long size)
 #endif //MEMDEBUG
 {
 	void *ptr;
-	unsigned long int *memid;
+	memoryheader_t *header;
 
-	ptr = botimport.HunkAlloc(size + sizeof(qmax_align_t));
+	ptr = botimport.HunkAlloc(size + MEMORYHEADER_SIZE);
 	if (!ptr) return NULL;
-	memid = (unsigned long int *) ptr;
-	*memid = HUNK_ID;
-	return (unsigned long int *) ((char *) ptr + sizeof(qmax_align_t));
+	header = (memoryheader_t *) ptr;
+	header->id = HUNK_ID;
+	header->info = size;
+	return (char *) ptr + MEMORYHEADER_SIZE;
 } //end of the function GetHunkMemory
 //===========================================================================
 //
@@ -427,16 +675,92 @@ void *GetClearedHunkMemory(unsigned long size)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+void *GetMapMemory(unsigned long size)
+{
+	int total, chunksize;
+	maparenachunk_t *chunk;
+	memoryheader_t *header;
+	byte *ptr;
+
+	//keep every block aligned
+	total = (size + MEMORYHEADER_SIZE + MEMORYHEADER_SIZE - 1) & ~(MEMORYHEADER_SIZE - 1);
+	chunk = maparena;
+	if (!chunk || chunk->used + total > chunk->size)
+	{
+		chunksize = MAPARENA_CHUNK_SIZE;
+		if (total > chunksize) chunksize = total;
+		chunk = (maparenachunk_t *) botimport.GetMemory(MEMORYHEADER_SIZE + chunksize);
+		if (!chunk) return NULL;
+		chunk->next = maparena;
+		chunk->size = chunksize;
+		chunk->used = 0;
+		maparena = chunk;
+		maparenasize += chunksize;
+	} //end if
+	ptr = (byte *) chunk + MEMORYHEADER_SIZE + chunk->used;
+	chunk->used += total;
+	header = (memoryheader_t *) ptr;
+	header->id = ARENA_ID;
+	header->info = size;
+	maparenaused += total;
+	if (maparenaused > maparenapeak) maparenapeak = maparenaused;
+	return ptr + MEMORYHEADER_SIZE;
+} //end of the function GetMapMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void *GetClearedMapMemory(unsigned long size)
+{
+	void *ptr;
+
+	ptr = GetMapMemory(size);
+	if (ptr) Com_Memset(ptr, 0, size);
+	return ptr;
+} //end of the function GetClearedMapMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
+void FreeMapMemory(void)
+{
+	maparenachunk_t *chunk, *next;
+
+	for (chunk = maparena; chunk; chunk = next)
+	{
+		next = chunk->next;
+		botimport.FreeMemory(chunk);
+	} //end for
+	maparena = NULL;
+	maparenaused = 0;
+	maparenasize = 0;
+} //end of the function FreeMapMemory
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void FreeMemory(void *ptr)
 {
-	unsigned long int *memid;
+	memoryheader_t *header;
 
-	memid = (unsigned long int *) ((char *) ptr - sizeof(qmax_align_t));
+	header = (memoryheader_t *) ((char *) ptr - MEMORYHEADER_SIZE);
 
-	if (*memid == MEM_ID)
+	if (header->id == MEM_ID)
 	{
-		botimport.FreeMemory(memid);
+		zonememory -= header->info;
+		numzoneblocks--;
+		botimport.FreeMemory(header);
 	} //end if
+	else if (header->id == SLAB_ID)
+	{
+		FreeSlabMemory(header);
+	} //end else if
 } //end of the function FreeMemory
 //===========================================================================
 //
@@ -456,6 +780,29 @@ int AvailableMemory(void)
 //===========================================================================
 void PrintUsedMemorySize(void)
 {
+	int i, pagebytes, usedbytes, peakbytes, slabpagebytes, slabusedbytes;
+	slabclass_t *sc;
+
+	botimport.Print(PRT_MESSAGE, "zone: %d KB in %d blocks, peak %d KB\n",
+							zonememory >> 10, numzoneblocks, zonepeak >> 10);
+	slabpagebytes = slabusedbytes = 0;
+	for (i = 0; i < NUM_SLAB_CLASSES; i++)
+	{
+		sc = &slabclasses[i];
+		if (!sc->numpages && !sc->peakused) continue;
+		pagebytes = sc->numpages * SLAB_PAGE_SIZE;
+		usedbytes = sc->numused * sc->blocksize;
+		peakbytes = sc->peakused * sc->blocksize;
+		botimport.Print(PRT_MESSAGE, "slab %4d: %4d pages, %6d blocks, peak %6d KB, %3d%% free, %3d%% padding\n",
+							sc->blocksize, sc->numpages, sc->numused, peakbytes >> 10,
+							pagebytes ? (pagebytes - usedbytes) * 100 / pagebytes : 0,
+							usedbytes ? (usedbytes - sc->requested) * 100 / usedbytes : 0);
+		slabpagebytes += pagebytes;
+		slabusedbytes += usedbytes;
+	} //end for
+	botimport.Print(PRT_MESSAGE, "slabs: %d KB in pages, %d KB in use\n", slabpagebytes >> 10, slabusedbytes >> 10);
+	botimport.Print(PRT_MESSAGE, "map arena: %d KB used of %d KB, peak %d KB\n",
+							maparenaused >> 10, maparenasize >> 10, maparenapeak >> 10);
 } //end of the function PrintUsedMemorySize
 //===========================================================================
 //
@@ -463,6 +810,23 @@ void PrintUsedMemorySize(void)
 // Returns:				-
 // Changes Globals:		-
 //===========================================================================
+int MemoryByteSize(void *ptr)
+{
+	memoryheader_t *header;
+
+	header = (memoryheader_t *) ((char *) ptr - MEMORYHEADER_SIZE);
+	if (header->id == SLAB_ID)
+	{
+		return header->info & ((1 << SLAB_PAGE_SHIFT) - 1);
+	} //end if
+	return header->info;
+} //end of the function MemoryByteSize
+//===========================================================================
+//
+// Parameter:			-
+// Returns:				-
+// Changes Globals:		-
+//===========================================================================
 void PrintMemoryLabels(void)
 {
 } //end of the function PrintMemoryLabels
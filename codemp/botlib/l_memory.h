@@ -69,6 +69,13 @@ void *GetClearedHunkMemory(unsigned long size);
 #endif
 #endif
 
+//allocate a memory block that lives until FreeMapMemory is called
+void *GetMapMemory(unsigned long size);
+//allocate a map memory block and clear it
+void *GetClearedMapMemory(unsigned long size);
+//free all map memory at once
+void FreeMapMemory(void);
+
 //free the given memory block
 void FreeMemory(void *ptr);
 //returns the amount available memory
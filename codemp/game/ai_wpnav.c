@@ -41,6 +41,36 @@ int nodenum; //so we can connect broken trails
 
 int gLevelFlags = 0;
 
+// neighbour linking state, lets CalculatePaths relink only around recent edits
+#define MAX_WP_EDITS		64
+
+static qboolean gWPLinked = qfalse; //neighbour lists match the current waypoint set
+static int gWPNumEdits = 0;
+static vec3_t gWPEditOrigins[MAX_WP_EDITS];
+
+static void WP_InvalidateLinks(void)
+{
+	gWPLinked = qfalse;
+	gWPNumEdits = 0;
+}
+
+static void WP_NoteEdit(vec3_t origin)
+{
+	if (!gWPLinked)
+	{
+		return;
+	}
+
+	if (gWPNumEdits >= MAX_WP_EDITS)
+	{ //too many to track, next CalculatePaths does a full pass
+		WP_InvalidateLinks();
+		return;
+	}
+
+	VectorCopy(origin, gWPEditOrigins[gWPNumEdits]);
+	gWPNumEdits++;
+}
+
 char *GetFlagStr( int flags )
 {
 	char *flagstr;
@@ -377,6 +407,8 @@ void TransferWPData(int from, int to)
 		trap->Print(S_COLOR_RED "FATAL ERROR: Could not allocated memory for waypoint\n");
 	}
 
+	WP_InvalidateLinks(); //indices are shifting, neighbour lists are stale
+
 	gWPArray[to]->flags = gWPArray[from]->flags;
 	gWPArray[to]->weight = gWPArray[from]->weight;
 	gWPArray[to]->associated_entity = gWPArray[from]->associated_entity;
@@ -416,6 +448,7 @@ void CreateNewWP(vec3_t origin, int flags)
 	gWPArray[gWPNum]->index = gWPNum;
 	gWPArray[gWPNum]->inuse = 1;
 	VectorCopy(origin, gWPArray[gWPNum]->origin);
+	WP_NoteEdit(origin);
 	gWPNum++;
 }
 
@@ -428,6 +461,8 @@ void CreateNewWP_FromObject(wpobject_t *wp)
 		return;
 	}
 
+	WP_InvalidateLinks(); //neighbour lists come from the caller
+
 	if (!gWPArray[gWPNum])
 	{
 		gWPArray[gWPNum] = (wpobject_t *)B_Alloc(sizeof(wpobject_t));
@@ -486,6 +521,8 @@ void RemoveWP(void)
 		return;
 	}
 
+	WP_NoteEdit(gWPArray[gWPNum]->origin);
+
 	//B_Free((wpobject_t *)gWPArray[gWPNum]);
 	if (gWPArray[gWPNum])
 	{
@@ -543,6 +580,8 @@ void RemoveWP_InTrail(int afterindex)
 		return;
 	}
 
+	WP_NoteEdit(gWPArray[foundindex]->origin);
+
 	i = 0;
 
 	while (i <= gWPNum)
@@ -1632,14 +1671,147 @@ int CanForceJumpTo(int baseindex, int testingindex, float distance)
 	}
 }
 
-void CalculatePaths(void)
+// spatial hash over waypoint xy so linking only looks at nearby candidates
+#define WP_GRID_BUCKETS		1024
+
+static int wpGridHead[WP_GRID_BUCKETS];
+static int wpGridNext[MAX_WPARRAY_SIZE];
+static float wpGridCellSize;
+
+static int WP_GridBucket(int cx, int cy)
+{
+	return (int)((((unsigned)cx * 73856093u) ^ ((unsigned)cy * 19349663u)) & (WP_GRID_BUCKETS-1));
+}
+
+static void WP_BuildGrid(float cellSize)
 {
 	int i;
-	int c;
+
+	wpGridCellSize = cellSize;
+
+	for (i = 0; i < WP_GRID_BUCKETS; i++)
+	{
+		wpGridHead[i] = -1;
+	}
+
+	//insert in reverse so every bucket chain is in ascending index order
+	for (i = gWPNum-1; i >= 0; i--)
+	{
+		if (gWPArray[i] && gWPArray[i]->inuse)
+		{
+			int b = WP_GridBucket((int)floor(gWPArray[i]->origin[0]/cellSize), (int)floor(gWPArray[i]->origin[1]/cellSize));
+
+			wpGridNext[i] = wpGridHead[b];
+			wpGridHead[b] = i;
+		}
+	}
+}
+
+static int WP_CompareIndex(const void *a, const void *b)
+{
+	return *(const int *)a - *(const int *)b;
+}
+
+//fills out with every waypoint whose xy distance to org could be within one cell, in ascending index order
+static int WP_GridCandidates(vec3_t org, int *out)
+{
+	int visited[9];
+	int numVisited = 0;
+	int num = 0;
+	int cx = (int)floor(org[0]/wpGridCellSize);
+	int cy = (int)floor(org[1]/wpGridCellSize);
+	int x, y, i;
+
+	for (x = cx-1; x <= cx+1; x++)
+	{
+		for (y = cy-1; y <= cy+1; y++)
+		{
+			int b = WP_GridBucket(x, y);
+			int c;
+
+			for (i = 0; i < numVisited; i++)
+			{
+				if (visited[i] == b)
+				{
+					break;
+				}
+			}
+
+			if (i < numVisited)
+			{ //hash collision with a cell we already walked
+				continue;
+			}
+
+			visited[numVisited++] = b;
+
+			for (c = wpGridHead[b]; c != -1; c = wpGridNext[c])
+			{
+				out[num++] = c;
+			}
+		}
+	}
+
+	qsort(out, num, sizeof(int), WP_CompareIndex);
+
+	return num;
+}
+
+static void WP_LinkNeighbors(int i, int maxNeighborDist, vec3_t mins, vec3_t maxs, int *candidates)
+{
+	int numCandidates;
+	int n, c;
 	int forceJumpable;
-	int maxNeighborDist = MAX_NEIGHBOR_LINK_DISTANCE;
 	float nLDist;
 	vec3_t a;
+
+	memset(gWPArray[i]->neighbors, 0, sizeof(gWPArray[i]->neighbors));
+	gWPArray[i]->neighbornum = 0;
+
+	numCandidates = WP_GridCandidates(gWPArray[i]->origin, candidates);
+
+	for (n = 0; n < numCandidates; n++)
+	{
+		c = candidates[n];
+
+		if (gWPArray[c] && gWPArray[c]->inuse && i != c &&
+			NotWithinRange(i, c))
+		{
+			VectorSubtract(gWPArray[i]->origin, gWPArray[c]->origin, a);
+
+			nLDist = VectorLength(a);
+			forceJumpable = CanForceJumpTo(i, c, nLDist);
+
+			if ((nLDist < maxNeighborDist || forceJumpable) &&
+				((int)gWPArray[i]->origin[2] == (int)gWPArray[c]->origin[2] || forceJumpable) &&
+				(OrgVisibleBox(gWPArray[i]->origin, mins, maxs, gWPArray[c]->origin, ENTITYNUM_NONE) || forceJumpable))
+			{
+				gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = c;
+				if (forceJumpable && ((int)gWPArray[i]->origin[2] != (int)gWPArray[c]->origin[2] || nLDist < maxNeighborDist))
+				{
+					gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 999;//forceJumpable; //FJSR
+				}
+				else
+				{
+					gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 0;
+				}
+				gWPArray[i]->neighbornum++;
+			}
+
+			if (gWPArray[i]->neighbornum >= MAX_NEIGHBOR_SIZE)
+			{
+				break;
+			}
+		}
+	}
+}
+
+void CalculatePaths(void)
+{
+	int i, n;
+	int maxNeighborDist = MAX_NEIGHBOR_LINK_DISTANCE;
+	int numCandidates;
+	int *candidates;
+	byte *relink;
 	vec3_t mins, maxs;
 
 	if (!gWPNum)
@@ -1659,69 +1831,44 @@ void CalculatePaths(void)
 	maxs[1] = 15;
 	maxs[2] = 15; //1
 
-	//now clear out all the neighbor data before we recalculate
-	i = 0;
+	//a pair can only link within maxNeighborDist, or by force jump within MAX_NEIGHBOR_LINK_DISTANCE on xy
+	WP_BuildGrid((float)Q_max(maxNeighborDist, MAX_NEIGHBOR_LINK_DISTANCE));
 
-	while (i < gWPNum)
-	{
-		if (gWPArray[i] && gWPArray[i]->inuse && gWPArray[i]->neighbornum)
+	candidates = (int *)B_TempAlloc(sizeof(int)*MAX_WPARRAY_SIZE);
+	relink = (byte *)B_TempAlloc(MAX_WPARRAY_SIZE);
+
+	if (gWPLinked)
+	{ //only waypoints that could see an edited spot as a candidate need relinking
+		memset(relink, 0, MAX_WPARRAY_SIZE);
+
+		for (n = 0; n < gWPNumEdits; n++)
 		{
-			while (gWPArray[i]->neighbornum >= 0)
+			numCandidates = WP_GridCandidates(gWPEditOrigins[n], candidates);
+
+			for (i = 0; i < numCandidates; i++)
 			{
-				gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = 0;
-				gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 0;
-				gWPArray[i]->neighbornum--;
+				relink[candidates[i]] = 1;
 			}
-			gWPArray[i]->neighbornum = 0;
 		}
-
-		i++;
+	}
+	else
+	{
+		memset(relink, 1, MAX_WPARRAY_SIZE);
 	}
 
-	i = 0;
-
-	while (i < gWPNum)
+	for (i = 0; i < gWPNum; i++)
 	{
-		if (gWPArray[i] && gWPArray[i]->inuse)
+		if (relink[i] && gWPArray[i] && gWPArray[i]->inuse)
 		{
-			c = 0;
-
-			while (c < gWPNum)
-			{
-				if (gWPArray[c] && gWPArray[c]->inuse && i != c &&
-					NotWithinRange(i, c))
-				{
-					VectorSubtract(gWPArray[i]->origin, gWPArray[c]->origin, a);
-
-					nLDist = VectorLength(a);
-					forceJumpable = CanForceJumpTo(i, c, nLDist);
-
-					if ((nLDist < maxNeighborDist || forceJumpable) &&
-						((int)gWPArray[i]->origin[2] == (int)gWPArray[c]->origin[2] || forceJumpable) &&
-						(OrgVisibleBox(gWPArray[i]->origin, mins, maxs, gWPArray[c]->origin, ENTITYNUM_NONE) || forceJumpable))
-					{
-						gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = c;
-						if (forceJumpable && ((int)gWPArray[i]->origin[2] != (int)gWPArray[c]->origin[2] || nLDist < maxNeighborDist))
-						{
-							gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 999;//forceJumpable; //FJSR
-						}
-						else
-						{
-							gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 0;
-						}
-						gWPArray[i]->neighbornum++;
-					}
-
-					if (gWPArray[i]->neighbornum >= MAX_NEIGHBOR_SIZE)
-					{
-						break;
-					}
-				}
-				c++;
-			}
+			WP_LinkNeighbors(i, maxNeighborDist, mins, maxs, candidates);
 		}
-		i++;
 	}
+
+	B_TempFree(MAX_WPARRAY_SIZE); //relink
+	B_TempFree(sizeof(int)*MAX_WPARRAY_SIZE); //candidates
+
+	gWPLinked = qtrue;
+	gWPNumEdits = 0;
 }
 
 gentity_t *GetObjectThatTargets(gentity_t *ent)
@@ -2016,6 +2163,264 @@ void CalculateJumpRoutes(void)
 	}
 }
 
+// binary route file (botroutes/<map>.wnb), laid out so it can be read in one go
+#define WPBIN_IDENT			(('B'<<24)+('N'<<16)+('P'<<8)+'W')
+#define WPBIN_VERSION		3
+
+typedef struct wpbinHeader_s
+{
+	int ident;
+	int version;
+	int sourceLength; //length, modification time and checksum of the .wnt it was built from
+	int sourceTime;
+	int sourceChecksum;
+	int levelFlags;
+	int numWaypoints;
+	int numNeighbors;
+} wpbinHeader_t;
+
+typedef struct wpbinWaypoint_s
+{
+	vec3_t origin;
+	int index;
+	int flags;
+	float weight;
+	float disttonext; //precomputed distance to the next waypoint in the trail
+	int firstNeighbor; //into the neighbour table following the waypoints
+	int numNeighbors;
+} wpbinWaypoint_t;
+
+#define WPBIN_CHECKSUM_INIT	2166136261u
+
+//FNV-1a, can be fed the file in pieces
+static unsigned int WPSourceChecksum(unsigned int hash, const char *buf, int len)
+{
+	int i;
+
+	for (i = 0; i < len; i++)
+	{
+		hash = (hash ^ (byte)buf[i]) * 16777619u;
+	}
+
+	return hash;
+}
+
+typedef enum
+{
+	WPBIN_UNUSABLE, //missing, corrupt or out of date, the text format is used
+	WPBIN_LOADED,
+	WPBIN_CHECK_SOURCE //the text route file has a different time, its checksum decides
+} wpbinResult_t;
+
+//sourceLength is -1 if there is no text route file to check the binary one against.
+//while the text file isn't read yet sourceChecksum is NULL, and the binary file is only
+//used if the length and time of the text file still match
+static wpbinResult_t LoadPathDataBinary(const char *filename, int sourceLength, int sourceTime, const int *sourceChecksum)
+{
+	fileHandle_t f;
+	char routePath[MAX_QPATH];
+	byte *buf = NULL;
+	wpbinHeader_t *header;
+	wpbinWaypoint_t *wps;
+	wpneighbor_t *neighbors;
+	wpobject_t thiswp;
+	int len;
+	int numWaypoints, numNeighbors;
+	int i, n;
+
+	Com_sprintf(routePath, sizeof(routePath), "botroutes/%s.wnb", filename);
+
+	len = trap->FS_Open(routePath, &f, FS_READ);
+
+	if (!f)
+	{
+		return WPBIN_UNUSABLE;
+	}
+
+	if (len < (int)sizeof(wpbinHeader_t))
+	{
+		trap->Print(S_COLOR_YELLOW "Binary route file %s is truncated, using text route data\n", routePath);
+		trap->FS_Close(f);
+		return WPBIN_UNUSABLE;
+	}
+
+	trap->TrueMalloc((void **)&buf, len);
+	trap->FS_Read(buf, len, f);
+	trap->FS_Close(f);
+
+	header = (wpbinHeader_t *)buf;
+	numWaypoints = LittleLong(header->numWaypoints);
+	numNeighbors = LittleLong(header->numNeighbors);
+
+	if (LittleLong(header->ident) != WPBIN_IDENT || LittleLong(header->version) != WPBIN_VERSION)
+	{
+		trap->Print(S_COLOR_YELLOW "Binary route file %s has the wrong version, using text route data\n", routePath);
+		trap->TrueFree((void **)&buf);
+		return WPBIN_UNUSABLE;
+	}
+
+	if (sourceLength != -1)
+	{
+		if (LittleLong(header->sourceLength) != sourceLength || (sourceChecksum && LittleLong(header->sourceChecksum) != *sourceChecksum))
+		{
+			trap->Print("Binary route file %s is out of date, using text route data\n", routePath);
+			trap->TrueFree((void **)&buf);
+			return WPBIN_UNUSABLE;
+		}
+
+		if (!sourceChecksum && (sourceTime == -1 || LittleLong(header->sourceTime) != sourceTime))
+		{
+			trap->TrueFree((void **)&buf);
+			return WPBIN_CHECK_SOURCE;
+		}
+	}
+
+	if (numWaypoints < 0 || numWaypoints > MAX_WPARRAY_SIZE || numNeighbors < 0 || numNeighbors > numWaypoints*MAX_NEIGHBOR_SIZE ||
+		len != (int)(sizeof(wpbinHeader_t) + numWaypoints*sizeof(wpbinWaypoint_t) + numNeighbors*sizeof(wpneighbor_t)))
+	{
+		trap->Print(S_COLOR_YELLOW "Binary route file %s is corrupt, using text route data\n", routePath);
+		trap->TrueFree((void **)&buf);
+		return WPBIN_UNUSABLE;
+	}
+
+	wps = (wpbinWaypoint_t *)(buf + sizeof(wpbinHeader_t));
+	neighbors = (wpneighbor_t *)(wps + numWaypoints);
+
+	//validate everything before touching the waypoint array
+	for (i = 0; i < numWaypoints; i++)
+	{
+		int first = LittleLong(wps[i].firstNeighbor);
+		int num = LittleLong(wps[i].numNeighbors);
+
+		if (num < 0 || num > MAX_NEIGHBOR_SIZE || first < 0 || first + num > numNeighbors)
+		{
+			break;
+		}
+
+		for (n = first; n < first + num; n++)
+		{
+			if (LittleLong(neighbors[n].num) < 0 || LittleLong(neighbors[n].num) >= numWaypoints)
+			{
+				break;
+			}
+		}
+
+		if (n != first + num)
+		{
+			break;
+		}
+	}
+
+	if (i != numWaypoints)
+	{
+		trap->Print(S_COLOR_YELLOW "Binary route file %s has bad neighbour data, using text route data\n", routePath);
+		trap->TrueFree((void **)&buf);
+		return WPBIN_UNUSABLE;
+	}
+
+	gLevelFlags = LittleLong(header->levelFlags);
+
+	for (i = 0; i < numWaypoints; i++)
+	{
+		int first = LittleLong(wps[i].firstNeighbor);
+
+		memset(&thiswp, 0, sizeof(thiswp));
+		thiswp.index = LittleLong(wps[i].index);
+		thiswp.flags = LittleLong(wps[i].flags);
+		thiswp.weight = LittleFloat(wps[i].weight);
+		thiswp.origin[0] = LittleFloat(wps[i].origin[0]);
+		thiswp.origin[1] = LittleFloat(wps[i].origin[1]);
+		thiswp.origin[2] = LittleFloat(wps[i].origin[2]);
+		thiswp.disttonext = LittleFloat(wps[i].disttonext);
+		thiswp.associated_entity = ENTITYNUM_NONE;
+		thiswp.neighbornum = LittleLong(wps[i].numNeighbors);
+
+		for (n = 0; n < thiswp.neighbornum; n++)
+		{
+			thiswp.neighbors[n].num = LittleLong(neighbors[first+n].num);
+			thiswp.neighbors[n].forceJumpTo = LittleLong(neighbors[first+n].forceJumpTo);
+		}
+
+		CreateNewWP_FromObject(&thiswp);
+	}
+
+	trap->TrueFree((void **)&buf);
+
+	return WPBIN_LOADED;
+}
+
+static int SavePathDataBinary(const char *filename, int sourceLength, int sourceTime, int sourceChecksum)
+{
+	fileHandle_t f;
+	char routePath[MAX_QPATH];
+	byte *buf = NULL;
+	wpbinHeader_t *header;
+	wpbinWaypoint_t *wps;
+	wpneighbor_t *neighbors;
+	int numNeighbors = 0;
+	int len;
+	int i, n;
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		numNeighbors += gWPArray[i]->neighbornum;
+	}
+
+	len = sizeof(wpbinHeader_t) + gWPNum*sizeof(wpbinWaypoint_t) + numNeighbors*sizeof(wpneighbor_t);
+
+	Com_sprintf(routePath, sizeof(routePath), "botroutes/%s.wnb", filename);
+
+	trap->FS_Open(routePath, &f, FS_WRITE);
+
+	if (!f)
+	{
+		trap->Print(S_COLOR_RED "ERROR: Could not open file to write binary path data\n");
+		return 0;
+	}
+
+	trap->TrueMalloc((void **)&buf, len);
+
+	header = (wpbinHeader_t *)buf;
+	header->ident = LittleLong(WPBIN_IDENT);
+	header->version = LittleLong(WPBIN_VERSION);
+	header->sourceLength = LittleLong(sourceLength);
+	header->sourceTime = LittleLong(sourceTime);
+	header->sourceChecksum = LittleLong(sourceChecksum);
+	header->levelFlags = LittleLong(gLevelFlags);
+	header->numWaypoints = LittleLong(gWPNum);
+	header->numNeighbors = LittleLong(numNeighbors);
+
+	wps = (wpbinWaypoint_t *)(buf + sizeof(wpbinHeader_t));
+	neighbors = (wpneighbor_t *)(wps + gWPNum);
+	numNeighbors = 0;
+
+	for (i = 0; i < gWPNum; i++)
+	{
+		wps[i].origin[0] = LittleFloat(gWPArray[i]->origin[0]);
+		wps[i].origin[1] = LittleFloat(gWPArray[i]->origin[1]);
+		wps[i].origin[2] = LittleFloat(gWPArray[i]->origin[2]);
+		wps[i].index = LittleLong(gWPArray[i]->index);
+		wps[i].flags = LittleLong(gWPArray[i]->flags);
+		wps[i].weight = LittleFloat(gWPArray[i]->weight);
+		wps[i].disttonext = LittleFloat(gWPArray[i]->disttonext);
+		wps[i].firstNeighbor = LittleLong(numNeighbors);
+		wps[i].numNeighbors = LittleLong(gWPArray[i]->neighbornum);
+
+		for (n = 0; n < gWPArray[i]->neighbornum; n++, numNeighbors++)
+		{
+			neighbors[numNeighbors].num = LittleLong(gWPArray[i]->neighbors[n].num);
+			neighbors[numNeighbors].forceJumpTo = LittleLong(gWPArray[i]->neighbors[n].forceJumpTo);
+		}
+	}
+
+	trap->FS_Write(buf, len, f);
+	trap->FS_Close(f);
+
+	trap->TrueFree((void **)&buf);
+
+	return 1;
+}
+
 int LoadPathData(const char *filename)
 {
 	fileHandle_t f;
@@ -2024,6 +2429,8 @@ int LoadPathData(const char *filename)
 	char *routePath;
 	wpobject_t thiswp;
 	int len;
+	int sourceTime, checksum;
+	wpbinResult_t binResult;
 	int i, i_cv;
 	int nei_num;
 
@@ -2040,21 +2447,45 @@ int LoadPathData(const char *filename)
 
 	if (!f)
 	{
+		//a binary route file can be used on its own
+		if (LoadPathDataBinary(filename, -1, -1, NULL) == WPBIN_LOADED)
+		{
+			goto loaded;
+		}
+
 		trap->Print(S_COLOR_YELLOW "Bot route data not found for %s\n", filename);
 		return 2;
 	}
 
-	if (len >= 524288)
+	//don't read the text file at all while the binary one was built from it
+	sourceTime = trap->FS_FileTime(f);
+	binResult = LoadPathDataBinary(filename, len, sourceTime, NULL);
+
+	if (binResult == WPBIN_LOADED)
 	{
-		trap->Print(S_COLOR_RED "Route file exceeds maximum length\n");
-		trap->FS_Close( f );
-		return 0;
+		trap->FS_Close(f);
+		goto loaded;
 	}
 
-	fileString = (char *)B_TempAlloc(524288);
-	currentVar = (char *)B_TempAlloc(2048);
+	fileString = NULL;
+	trap->TrueMalloc((void **)&fileString, len+1);
 
 	trap->FS_Read(fileString, len, f);
+	fileString[len] = 0;
+
+	trap->FS_Close(f);
+
+	checksum = (int)WPSourceChecksum(WPBIN_CHECKSUM_INIT, fileString, len);
+
+	if (binResult == WPBIN_CHECK_SOURCE && LoadPathDataBinary(filename, len, sourceTime, &checksum) == WPBIN_LOADED)
+	{
+		//same contents, record the new time so the next load skips the text again
+		trap->TrueFree((void **)&fileString);
+		SavePathDataBinary(filename, len, sourceTime, checksum);
+		goto loaded;
+	}
+
+	currentVar = (char *)B_TempAlloc(2048);
 
 	if (fileString[i] == 'l')
 	{ //contains a "levelflags" entry..
@@ -2241,11 +2672,13 @@ int LoadPathData(const char *filename)
 		i++;
 	}
 
-	B_TempFree(524288); //fileString
 	B_TempFree(2048); //currentVar
+	trap->TrueFree((void **)&fileString);
 
-	trap->FS_Close(f);
+	//rebuild the binary route file so the next load doesn't have to parse the text
+	SavePathDataBinary(filename, len, sourceTime, checksum);
 
+loaded:
 	if (level.gametype == GT_SIEGE)
 	{
 		CalculateSiegeGoals();
@@ -2384,14 +2817,14 @@ void FlagObjects(void)
 int SavePathData(const char *filename)
 {
 	fileHandle_t f;
-	char *fileString;
 	char *storeString;
 	char *routePath;
 	vec3_t a;
 	float flLen;
+	unsigned int hash;
+	int len, checksum;
 	int i, n;
 
-	fileString = NULL;
 	i = 0;
 
 	if (!gWPNum)
@@ -2423,45 +2856,13 @@ int SavePathData(const char *filename)
 
 	FlagObjects(); //currently only used for flagging waypoints nearest CTF flags
 
-	fileString = (char *)B_TempAlloc(524288);
 	storeString = (char *)B_TempAlloc(4096);
+	hash = WPBIN_CHECKSUM_INIT;
+	len = 0;
 
-	Com_sprintf(fileString, 524288, "%i %i %f (%f %f %f) { ", gWPArray[i]->index, gWPArray[i]->flags, gWPArray[i]->weight, gWPArray[i]->origin[0], gWPArray[i]->origin[1], gWPArray[i]->origin[2]);
-
-	n = 0;
-
-	while (n < gWPArray[i]->neighbornum)
-	{
-		if (gWPArray[i]->neighbors[n].forceJumpTo)
-		{
-			Com_sprintf(storeString, 4096, "%s%i-%i ", storeString, gWPArray[i]->neighbors[n].num, gWPArray[i]->neighbors[n].forceJumpTo);
-		}
-		else
-		{
-			Com_sprintf(storeString, 4096, "%s%i ", storeString, gWPArray[i]->neighbors[n].num);
-		}
-		n++;
-	}
-
-	if (gWPArray[i+1] && gWPArray[i+1]->inuse && gWPArray[i+1]->index)
-	{
-		VectorSubtract(gWPArray[i]->origin, gWPArray[i+1]->origin, a);
-		flLen = VectorLength(a);
-	}
-	else
-	{
-		flLen = 0;
-	}
-
-	gWPArray[i]->disttonext = flLen;
-
-	Com_sprintf(fileString, 524288, "%s} %f\n", fileString, flLen);
-
-	i++;
-
+	//written a line at a time, so the size of the route data isn't limited
 	while (i < gWPNum)
 	{
-		//sprintf(fileString, "%s%i %i %f (%f %f %f) { ", fileString, gWPArray[i]->index, gWPArray[i]->flags, gWPArray[i]->weight, gWPArray[i]->origin[0], gWPArray[i]->origin[1], gWPArray[i]->origin[2]);
 		Com_sprintf(storeString, 4096, "%i %i %f (%f %f %f) { ", gWPArray[i]->index, gWPArray[i]->flags, gWPArray[i]->weight, gWPArray[i]->origin[0], gWPArray[i]->origin[1], gWPArray[i]->origin[2]);
 
 		n = 0;
@@ -2470,11 +2871,11 @@ int SavePathData(const char *filename)
 		{
 			if (gWPArray[i]->neighbors[n].forceJumpTo)
 			{
-				Com_sprintf(storeString, 4096, "%s%i-%i ", storeString, gWPArray[i]->neighbors[n].num, gWPArray[i]->neighbors[n].forceJumpTo);
+				Q_strcat(storeString, 4096, va("%i-%i ", gWPArray[i]->neighbors[n].num, gWPArray[i]->neighbors[n].forceJumpTo));
 			}
 			else
 			{
-				Com_sprintf(storeString, 4096, "%s%i ", storeString, gWPArray[i]->neighbors[n].num);
+				Q_strcat(storeString, 4096, va("%i ", gWPArray[i]->neighbors[n].num));
 			}
 			n++;
 		}
@@ -2491,20 +2892,28 @@ int SavePathData(const char *filename)
 
 		gWPArray[i]->disttonext = flLen;
 
-		Com_sprintf(storeString, 4096, "%s} %f\n", storeString, flLen);
+		Q_strcat(storeString, 4096, va("} %f\n", flLen));
 
-		strcat(fileString, storeString);
+		n = strlen(storeString);
+		trap->FS_Write(storeString, n, f);
+		hash = WPSourceChecksum(hash, storeString, n);
+		len += n;
 
 		i++;
 	}
 
-	trap->FS_Write(fileString, strlen(fileString), f);
+	checksum = (int)hash;
 
-	B_TempFree(524288); //fileString
 	B_TempFree(4096); //storeString
 
 	trap->FS_Close(f);
 
+	//the time of the written file isn't known here, the next load checks the contents once
+	if (!SavePathDataBinary(filename, len, -1, checksum))
+	{
+		return 0;
+	}
+
 	trap->Print("Path data has been saved and updated. You may need to restart the level for some things to be properly calculated.\n");
 
 	return 1;
@@ -2699,28 +3108,32 @@ void G_DebugNodeFile()
 	fileHandle_t f;
 	int i = 0;
 	float placeX;
-	char fileString[131072];
+	char *str;
 	gentity_t *terrain = G_Find( NULL, FOFS(classname), "terrain" );
 
-	fileString[0] = 0;
+	trap->FS_Open("ROUTEDEBUG.txt", &f, FS_WRITE);
+
+	if (!f)
+	{
+		return;
+	}
 
 	placeX = terrain->r.absmin[0];
 
 	while (i < nodenum)
 	{
-		strcat(fileString, va("%i-%f ", i, nodetable[i].weight));
+		str = va("%i-%f ", i, nodetable[i].weight);
+		trap->FS_Write(str, strlen(str), f);
 		placeX += DEFAULT_GRID_SPACING;
 
 		if (placeX >= terrain->r.absmax[0])
 		{
-			strcat(fileString, "\n");
+			trap->FS_Write("\n", 1, f);
 			placeX = terrain->r.absmin[0];
 		}
 		i++;
 	}
 
-	trap->FS_Open("ROUTEDEBUG.txt", &f, FS_WRITE);
-	trap->FS_Write(fileString, strlen(fileString), f);
 	trap->FS_Close(f);
 }
 #endif
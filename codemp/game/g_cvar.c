@@ -58,10 +58,14 @@ static const cvarTable_t gameCvarTable[] = {
 };
 static const size_t gameCvarTableSize = ARRAY_LEN( gameCvarTable );
 
+static int lastCvarModificationCount = -1;
+
 void G_RegisterCvars( void ) {
 	size_t i = 0;
 	const cvarTable_t *cv = NULL;
 
+	lastCvarModificationCount = -1;
+
 	for ( i=0, cv=gameCvarTable; i<gameCvarTableSize; i++, cv++ ) {
 		trap->Cvar_Register( cv->vmCvar, cv->cvarName, cv->defaultString, cv->cvarFlags );
 		if ( cv->update )
@@ -72,6 +76,12 @@ void G_RegisterCvars( void ) {
 void G_UpdateCvars( void ) {
 	size_t i = 0;
 	const cvarTable_t *cv = NULL;
+	int modificationCount = trap->Cvar_ModificationCount();
+
+	// nothing to update unless some cvar changed since the last pass
+	if ( modificationCount == lastCvarModificationCount )
+		return;
+	lastCvarModificationCount = modificationCount;
 
 	for ( i=0, cv=gameCvarTable; i<gameCvarTableSize; i++, cv++ ) {
 		if ( cv->vmCvar ) {
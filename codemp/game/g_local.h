@@ -1310,6 +1310,7 @@ extern gentity_t *gJMSaberEnt;
 //
 qboolean	ConsoleCommand( void );
 void G_ProcessIPBans(void);
+void G_ClearIPFilters(void);
 qboolean G_FilterPacket (char *from);
 
 //
@@ -1547,6 +1548,9 @@ void G_InitDatabase( void );
 
 // g_nmintegration.c
 void G_SendNMServerCommand( int clientNum, const char* cmd, const char* argsFmt, ... );
+
+// g_syscalls.c
+void G_FreeFrameMemory( void );
 void G_InitNMAuth( void );
 void G_NMAuthAnnounce( gentity_t* ent );
 void G_NMAuthSendVerification( gentity_t* ent, const char* encryptedMsg );
@@ -421,6 +421,8 @@ void G_ShutdownGame( int restart ) {
 
 	BG_ClearAnimsets(); //free all dynamic allocations made through the engine
 
+	G_FreeFrameMemory(); //whatever was handed out since the last frame
+
 //	Com_Printf("... Gameside GHOUL2 Cleanup\n");
 	while (i < MAX_GENTITIES)
 	{ //clean up all the ghoul2 instances
@@ -477,6 +479,8 @@ void G_ShutdownGame( int restart ) {
 	}
 
 	B_CleanupAlloc(); //clean up all allocations made with B_Alloc
+
+	G_ClearIPFilters();
 }
 
 /*
@@ -2849,12 +2853,10 @@ void G_RunFrame( int levelTime ) {
 	{
 		if (level.restarted)
 		{
-			char buf[128];
 			float tFVal = 0;
 
-			trap->Cvar_VariableStringBuffer("timescale", buf, sizeof(buf));
-
-			tFVal = atof(buf);
+			trap->Cvar_Update(&timescale);
+			tFVal = timescale.value;
 
 			trap->Cvar_Set("timescale", "1");
 			if (tFVal == 1.0f)
@@ -2886,12 +2888,10 @@ void G_RunFrame( int levelTime ) {
 			}
 			else
 			{
-				char buf[128];
 				float tFVal = 0;
 
-				trap->Cvar_VariableStringBuffer("timescale", buf, sizeof(buf));
-
-				tFVal = atof(buf);
+				trap->Cvar_Update(&timescale);
+				tFVal = timescale.value;
 
 				trap->Cvar_Set("timescale", "1");
 				if (timeDif > 1500 && tFVal == 1.0f)
@@ -2904,6 +2904,7 @@ void G_RunFrame( int levelTime ) {
 
 	// if we are waiting for the level to restart, do nothing
 	if ( level.restarted ) {
+		G_FreeFrameMemory();
 		return;
 	}
 
@@ -3336,6 +3337,9 @@ void G_RunFrame( int levelTime ) {
 #endif
 
 	g_LastFrameTime = level.time;
+
+	// only the legacy syscall interface hands out frame memory the game frees
+	G_FreeFrameMemory();
 }
 
 const char *G_GetStringEdString(char *refSection, char *refName)
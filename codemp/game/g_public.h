@@ -30,7 +30,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #define Q3_INFINITE			16777216
 
 // alpha - no conflict with other APIs
-#define	GAME_API_VERSION	5000
+#define	GAME_API_VERSION	5001
 
 // entity->svFlags
 // the server does not know how to interpret most of the values
@@ -382,6 +382,10 @@ typedef struct T_G_ICARUS_GETSETIDFORSTRING_s {
 // return qtrue to continue, qfalse to abort
 typedef qboolean ( *DBResultCallback )( int numCols, const char** colNames, const char** colValues, void* userData );
 
+// callback called once an asynchronous query is done, after all its rows were passed
+// to the result callback. success is qfalse if an error occured
+typedef void ( *DBCompleteCallback )( qboolean success, void* userData );
+
 // wrapper type for sql statements that provides functions for an
 // OOP like interface instead of having lots of new trap calls
 typedef struct dbStmt_s {
@@ -1181,6 +1185,17 @@ typedef struct gameImport_s {
 	void		( *DB_SetData )							( const char* name, void* data, size_t size );
 	const void*	( *DB_GetData )							( const char* name, size_t* outSize, qboolean remove );
 
+	// asynchronous database access: queries run on the database thread and the callbacks
+	// are called on the main thread during a later frame. bindings of an async statement
+	// are copied when it is executed, so it can be bound again right away. async statements
+	// can't be stepped, use DB_FreeStatement to free them
+	// async queries of a frame are executed in a single transaction, so they must not
+	// begin or commit transactions themselves
+	// the synchronous calls above wait for pending async queries, use them at startup only
+	dbStmt_t*	( *DB_CreateAsyncStatement )			( const char* sql );
+	qboolean	( *DB_ExecStatementAsync )				( dbStmt_t* stmt, DBResultCallback callback, DBCompleteCallback complete, void* userData );
+	qboolean	( *DB_ExecQueryAsync )					( const char* sql, DBResultCallback callback, DBCompleteCallback complete, void* userData );
+
 	// crypto
 	qboolean	( *Crypto_GenerateKeys )				( publicKey_t* pk, secretKey_t* sk );
 	qboolean	( *Crypto_LoadKeysFromFS )				( publicKey_t* pk, const char* pkFilename, secretKey_t* sk, const char* skFilename );
@@ -1188,6 +1203,21 @@ typedef struct gameImport_s {
 	qboolean	( *Crypto_EncryptString )				( publicKey_t* pk, const char* inRaw, char* outHex, size_t outHexSize );
 	qboolean	( *Crypto_DecryptString )				( publicKey_t* pk, secretKey_t* sk, const char* inHex, char* outRaw, size_t outRawSize );
 	qboolean	( *Crypto_Hash )						( const char* inRaw, char* outHex, size_t outHexSize );
+
+	// scratch memory, 16 byte aligned and not zero filled, valid until the end of the
+	// current server frame and never to be freed
+	void*		( *Frame_Alloc )						( int size );
+
+	// index of name in configstrings start + 1 .. start + max - 1, up to the first empty
+	// one, which it is put in if create is set. 0 if not found
+	int			( *FindConfigstringIndex )				( const char *name, int start, int max, qboolean create );
+
+	// changes whenever any cvar is created, changed or removed
+	int			( *Cvar_ModificationCount )				( void );
+
+	// modification time of an open file, only good for comparing with an earlier
+	// value. -1 if unknown
+	int			( *FS_FileTime )						( fileHandle_t f );
 } gameImport_t;
 
 typedef struct gameExport_s {
@@ -25,6 +25,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 // this file holds commands that can be executed by the server console, but not remote clients
 
 #include "g_local.h"
+#include "qcommon/q_iptrie.h"
 
 /*
 ==============================================================================
@@ -56,6 +57,7 @@ If 0, then only addresses matching the list will be allowed.  This lets you easi
 
 typedef struct ipFilter_s {
 	uint32_t mask, compare;
+	int prefix; // length of the mask in bits, -1 if wildcards leave holes in it
 } ipFilter_t;
 
 #define	MAX_IPFILTERS (1024)
@@ -63,6 +65,11 @@ typedef struct ipFilter_s {
 static ipFilter_t	ipFilters[MAX_IPFILTERS];
 static int			numIPFilters;
 
+// filters that are plain prefixes are matched through a trie, the rest linearly
+static ipTrie_t		ipFilterTrie = { NULL, 0, 0, -1, 0 };
+static int			numIrregularIPFilters;
+static qboolean		ipFilterTrieDirty = qtrue;
+
 /*
 =================
 StringToFilter
@@ -107,9 +114,68 @@ static qboolean StringToFilter( char *s, ipFilter_t *f ) {
 	f->mask = m.ui;
 	f->compare = b.ui;
 
+	f->prefix = 0;
+	while ( f->prefix < 4 && m.b[f->prefix] == 0xFF )
+		f->prefix++;
+	for ( i=f->prefix; i<4; i++ ) {
+		if ( m.b[i] ) {
+			f->prefix = -1;
+			return qtrue;
+		}
+	}
+	f->prefix *= 8;
+
 	return qtrue;
 }
 
+/*
+=================
+FilterAddress
+
+Host order address of a filter for the trie
+=================
+*/
+static uint32_t FilterAddress( uint32_t ui ) {
+	byteAlias_t b;
+
+	b.ui = ui;
+	return ((uint32_t)b.b[0] << 24) | ((uint32_t)b.b[1] << 16) | ((uint32_t)b.b[2] << 8) | (uint32_t)b.b[3];
+}
+
+/*
+=================
+RebuildIPFilterTrie
+=================
+*/
+static void RebuildIPFilterTrie( void ) {
+	int i;
+
+	IPTrie_Clear( &ipFilterTrie );
+	numIrregularIPFilters = 0;
+
+	for ( i=0; i<numIPFilters; i++ ) {
+		if ( ipFilters[i].compare == 0xFFFFFFFFu )
+			continue;
+
+		if ( ipFilters[i].prefix < 0 )
+			numIrregularIPFilters++;
+		else
+			IPTrie_Insert( &ipFilterTrie, FilterAddress( ipFilters[i].compare ), ipFilters[i].prefix, 1 );
+	}
+
+	ipFilterTrieDirty = qfalse;
+}
+
+/*
+=================
+G_ClearIPFilters
+=================
+*/
+void G_ClearIPFilters( void ) {
+	IPTrie_Clear( &ipFilterTrie );
+	ipFilterTrieDirty = qtrue;
+}
+
 /*
 =================
 UpdateIPBans
@@ -172,8 +238,14 @@ qboolean G_FilterPacket( char *from ) {
 
 	in = m.ui;
 
-	for ( i=0; i<numIPFilters; i++ ) {
-		if ( (in & ipFilters[i].mask) == ipFilters[i].compare )
+	if ( ipFilterTrieDirty )
+		RebuildIPFilterTrie();
+
+	if ( IPTrie_Match( &ipFilterTrie, FilterAddress( in ) ) )
+		return g_filterBan.integer != 0;
+
+	for ( i=0; numIrregularIPFilters && i<numIPFilters; i++ ) {
+		if ( ipFilters[i].prefix < 0 && (in & ipFilters[i].mask) == ipFilters[i].compare )
 			return g_filterBan.integer != 0;
 	}
 
@@ -203,6 +275,7 @@ static void AddIP( char *str ) {
 	if ( !StringToFilter( str, &ipFilters[i] ) )
 		ipFilters[i].compare = 0xFFFFFFFFu;
 
+	ipFilterTrieDirty = qtrue;
 	UpdateIPBans();
 }
 
@@ -273,6 +346,7 @@ void Svcmd_RemoveIP_f (void)
 		if (ipFilters[i].mask == f.mask	&&
 			ipFilters[i].compare == f.compare) {
 			ipFilters[i].compare = 0xffffffffu;
+			ipFilterTrieDirty = qtrue;
 			trap->Print ("Removed.\n");
 
 			UpdateIPBans();
@@ -1010,6 +1010,76 @@ void SVSyscall_Trace( trace_t *results, const vec3_t start, const vec3_t mins, c
 		trap_Trace( results, start, mins, maxs, end, passEntityNum, contentmask );
 }
 
+// the syscall interface has no configstring index lookup, scan them like the engine used to
+int SVSyscall_FindConfigstringIndex( const char *name, int start, int max, qboolean create ) {
+	int		i;
+	char	s[MAX_STRING_CHARS];
+
+	for ( i=1 ; i<max ; i++ ) {
+		trap_GetConfigstring( start + i, s, sizeof( s ) );
+		if ( !s[0] ) {
+			break;
+		}
+		if ( !strcmp( s, name ) ) {
+			return i;
+		}
+	}
+
+	if ( !create ) {
+		return 0;
+	}
+
+	if ( i == max ) {
+		trap_Error( "G_FindConfigstringIndex: overflow" );
+	}
+
+	trap_SetConfigstring( start + i, name );
+
+	return i;
+}
+
+// the syscall interface has no frame memory, so it comes from TrueMalloc and is
+// freed by G_FreeFrameMemory at the end of G_RunFrame
+typedef struct frameMemory_s {
+	struct frameMemory_s	*next;
+} frameMemory_t;
+
+static frameMemory_t *frameMemory = NULL;
+
+void *SVSyscall_Frame_Alloc( int size ) {
+	frameMemory_t *mem = NULL;
+
+	// room to align the block to 16 bytes past the header
+	trap_TrueMalloc( (void **)&mem, sizeof( frameMemory_t ) + 15 + Q_max( size, 1 ) );
+	if ( !mem ) {
+		trap_Error( "Frame_Alloc: out of memory" );
+	}
+	mem->next = frameMemory;
+	frameMemory = mem;
+
+	return (void *)( ( (intptr_t)( mem + 1 ) + 15 ) & ~(intptr_t)15 );
+}
+
+void G_FreeFrameMemory( void ) {
+	while ( frameMemory ) {
+		frameMemory_t *mem = frameMemory;
+
+		frameMemory = mem->next;
+		trap_TrueFree( (void **)&mem );
+	}
+}
+
+// the syscall interface has no file times, so route caches always check the contents
+int SVSyscall_FS_FileTime( fileHandle_t f ) {
+	return -1;
+}
+
+// the syscall interface can't tell whether cvars changed, so report a change every time
+int SVSyscall_Cvar_ModificationCount( void ) {
+	static int count = 0;
+	return ++count;
+}
+
 NORETURN void QDECL G_Error( int errorLevel, const char *error, ... ) {
 	va_list argptr;
 	char text[1024];
@@ -1054,10 +1124,12 @@ static void TranslateSyscalls( void ) {
 	trap->RealTime							= trap_RealTime;
 	trap->TrueMalloc						= trap_TrueMalloc;
 	trap->TrueFree							= trap_TrueFree;
+	trap->Frame_Alloc						= SVSyscall_Frame_Alloc;
 	trap->SnapVector						= trap_SnapVector;
 	trap->Cvar_Register						= trap_Cvar_Register;
 	trap->Cvar_Set							= trap_Cvar_Set;
 	trap->Cvar_Update						= trap_Cvar_Update;
+	trap->Cvar_ModificationCount			= SVSyscall_Cvar_ModificationCount;
 	trap->Cvar_VariableIntegerValue			= trap_Cvar_VariableIntegerValue;
 	trap->Cvar_VariableStringBuffer			= trap_Cvar_VariableStringBuffer;
 	trap->Argc								= trap_Argc;
@@ -1067,6 +1139,7 @@ static void TranslateSyscalls( void ) {
 	trap->FS_Open							= trap_FS_FOpenFile;
 	trap->FS_Read							= SVSyscall_FS_Read;
 	trap->FS_Write							= SVSyscall_FS_Write;
+	trap->FS_FileTime						= SVSyscall_FS_FileTime;
 	trap->AdjustAreaPortalState				= trap_AdjustAreaPortalState;
 	trap->AreasConnected					= trap_AreasConnected;
 	trap->DebugPolygonCreate				= trap_DebugPolygonCreate;
@@ -1089,6 +1162,7 @@ static void TranslateSyscalls( void ) {
 	trap->SendServerCommand					= trap_SendServerCommand;
 	trap->SetBrushModel						= trap_SetBrushModel;
 	trap->SetConfigstring					= trap_SetConfigstring;
+	trap->FindConfigstringIndex				= SVSyscall_FindConfigstringIndex;
 	trap->SetServerCull						= trap_SetServerCull;
 	trap->SetUserinfo						= trap_SetUserinfo;
 	trap->SiegePersSet						= trap_SiegePersSet;
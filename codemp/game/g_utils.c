@@ -85,34 +85,11 @@ G_FindConfigstringIndex
 ================
 */
 static int G_FindConfigstringIndex( const char *name, int start, int max, qboolean create ) {
-	int		i;
-	char	s[MAX_STRING_CHARS];
-
 	if ( !VALIDSTRING( name ) ) {
 		return 0;
 	}
 
-	for ( i=1 ; i<max ; i++ ) {
-		trap->GetConfigstring( start + i, s, sizeof( s ) );
-		if ( !s[0] ) {
-			break;
-		}
-		if ( !strcmp( s, name ) ) {
-			return i;
-		}
-	}
-
-	if ( !create ) {
-		return 0;
-	}
-
-	if ( i == max ) {
-		trap->Error( ERR_DROP, "G_FindConfigstringIndex: overflow" );
-	}
-
-	trap->SetConfigstring( start + i, name );
-
-	return i;
+	return trap->FindConfigstringIndex( name, start, max, create );
 }
 
 /*
@@ -264,6 +264,9 @@ void NORETURN QDECL Com_Error( int code, const char *fmt, ... ) {
 		Cvar_Set("com_errorMessage", com_errorMessage);
 	}
 
+	// get everything logged up to the error into the file
+	Com_FlushLog();
+
 	if ( code == ERR_DISCONNECT || code == ERR_SERVERDISCONNECT || code == ERR_DROP || code == ERR_NEED_CD ) {
 		throw code;
 	} else {
@@ -690,9 +693,9 @@ void Com_InitLogging( void ) {
 
 		// default to buffer log except for debug builds which are more likely to not be stopped graciously/to be tested for crashes
 #ifndef _DEBUG
-		log_enable = Cvar_Get( "log_enable", "1", CVAR_INIT, "Enables logging console to a file (1 for buffer log, 2 to flush after each print)" );
+		log_enable = Cvar_Get( "log_enable", "1", CVAR_INIT, "Enables logging console to a file (1 for buffer log, 2 to flush after each print, 3 to write on a background thread)" );
 #else
-		log_enable = Cvar_Get( "log_enable", "2", CVAR_INIT, "Enables logging console to a file (1 for buffer log, 2 to flush after each print)" );
+		log_enable = Cvar_Get( "log_enable", "2", CVAR_INIT, "Enables logging console to a file (1 for buffer log, 2 to flush after each print, 3 to write on a background thread)" );
 #endif
 
 		log_fileFormat = Cvar_Get( "log_fileFormat", "logs/enhanced_%Y_%m_%d_%H_%M_%S.log", CVAR_INIT, "Name format (strftime) of log files" );
@@ -718,10 +721,16 @@ void Com_InitLogging( void ) {
 		char filePath[MAX_QPATH];
 		strftime( filePath, sizeof( filePath ), log_fileFormat->string, newtime );
 
-		logfile = FS_FOpenFileWrite( filePath );
+		if ( log_enable->integer == 3 ) {
+			// prints only copy into a buffer, the async writers flush it every few hundred msec
+			// and Com_FlushLog waits for them on errors and crashes
+			logfile = FS_FOpenFileWriteAsync( filePath );
+		} else {
+			logfile = FS_FOpenFileWrite( filePath );
+		}
 
 		if ( logfile ) {
-			if ( log_enable->integer > 1 ) {
+			if ( log_enable->integer == 2 ) {
 				FS_ForceFlush( logfile ); // force it to not buffer so we get valid data even if we are crashing
 			}
 
@@ -740,6 +749,20 @@ void Com_InitLogging( void ) {
 	Cvar_SetValue( "log_enable", 0 );
 }
 
+/*
+=================
+Com_FlushLog
+
+Makes sure everything logged so far is in the file, e.g. before
+going down on an error
+=================
+*/
+void Com_FlushLog( void ) {
+	if ( logfile && FS_Initialized() ) {
+		FS_Flush( logfile );
+	}
+}
+
 /*
 =================
 Com_CloseLogs
@@ -747,6 +770,7 @@ Com_CloseLogs
 */
 void Com_CloseLogs( void ) {
 	if ( logfile ) {
+		Com_FlushLog();
 		FS_FCloseFile( logfile );
 		logfile = NULL_FILE;
 		log_enable->integer = 0;
@@ -34,8 +34,13 @@ uint32_t	cvar_modifiedFlags;
 cvar_t		cvar_indexes[MAX_CVARS];
 int			cvar_numIndexes;
 
-#define FILE_HASH_SIZE		512
-static	cvar_t*		hashTable[FILE_HASH_SIZE];
+// open addressed with linear probing, at most half full so probes stay short
+#define CVAR_HASH_SIZE		(MAX_CVARS * 2)
+static	cvar_t*		hashTable[CVAR_HASH_SIZE];
+static	unsigned int	hashValues[CVAR_HASH_SIZE];
+
+// bumped whenever any cvar changes, so modules can skip polling their vmCvars
+static	int			cvar_modificationCount;
 static	qboolean cvar_sort = qfalse;
 
 static char *lastMemPool = NULL;
@@ -53,25 +58,73 @@ static void Cvar_FreeString(char *string)
 
 /*
 ================
-return a hash value for the filename
+return a case insensitive hash value for the cvar name
 ================
 */
-static long generateHashValue( const char *fname ) {
-	int		i;
-	long	hash;
-	char	letter;
+static unsigned int generateHashValue( const char *var_name ) {
+	unsigned int hash = 2166136261u;
 
-	hash = 0;
-	i = 0;
-	while (fname[i] != '\0') {
-		letter = tolower((unsigned char)fname[i]);
-		hash+=(long)(letter)*(i+119);
-		i++;
+	for ( ; *var_name; var_name++ ) {
+		hash = ( hash ^ (unsigned int)tolower( (unsigned char)*var_name ) ) * 16777619u;
 	}
-	hash &= (FILE_HASH_SIZE-1);
+
 	return hash;
 }
 
+/*
+================
+Cvar_HashLink
+================
+*/
+static void Cvar_HashLink( cvar_t *var ) {
+	unsigned int hash = generateHashValue( var->name );
+	int slot = hash & ( CVAR_HASH_SIZE - 1 );
+
+	while ( hashTable[slot] ) {
+		slot = ( slot + 1 ) & ( CVAR_HASH_SIZE - 1 );
+	}
+
+	hashTable[slot] = var;
+	hashValues[slot] = hash;
+	var->hashIndex = slot;
+}
+
+/*
+================
+Cvar_HashUnlink
+
+Moves the entries probed past the freed slot back, so lookups never need
+deletion markers
+================
+*/
+static void Cvar_HashUnlink( cvar_t *var ) {
+	int hole = var->hashIndex;
+	int slot = hole;
+
+	hashTable[hole] = NULL;
+
+	for ( ;; ) {
+		int home;
+
+		slot = ( slot + 1 ) & ( CVAR_HASH_SIZE - 1 );
+		if ( !hashTable[slot] ) {
+			break;
+		}
+
+		// leave entries whose home slot lies cyclically in ( hole, slot ]
+		home = hashValues[slot] & ( CVAR_HASH_SIZE - 1 );
+		if ( ( ( slot - home ) & ( CVAR_HASH_SIZE - 1 ) ) < ( ( slot - hole ) & ( CVAR_HASH_SIZE - 1 ) ) ) {
+			continue;
+		}
+
+		hashTable[hole] = hashTable[slot];
+		hashValues[hole] = hashValues[slot];
+		hashTable[hole]->hashIndex = hole;
+		hashTable[slot] = NULL;
+		hole = slot;
+	}
+}
+
 /*
 ============
 Cvar_ValidateString
@@ -99,14 +152,12 @@ Cvar_FindVar
 ============
 */
 static cvar_t *Cvar_FindVar( const char *var_name ) {
-	cvar_t	*var;
-	long hash;
+	unsigned int hash = generateHashValue( var_name );
+	int slot;
 
-	hash = generateHashValue(var_name);
-
-	for (var=hashTable[hash] ; var ; var=var->hashNext) {
-		if (!Q_stricmp(var_name, var->name)) {
-			return var;
+	for ( slot = hash & ( CVAR_HASH_SIZE - 1 ); hashTable[slot]; slot = ( slot + 1 ) & ( CVAR_HASH_SIZE - 1 ) ) {
+		if ( hashValues[slot] == hash && !Q_stricmp( var_name, hashTable[slot]->name ) ) {
+			return hashTable[slot];
 		}
 	}
 
@@ -336,7 +387,6 @@ The flags will be or'ed in if the variable exists.
 */
 cvar_t *Cvar_Get( const char *var_name, const char *var_value, uint32_t flags, const char *var_desc ) {
 	cvar_t	*var;
-	long	hash;
 	int		index;
 
     if ( !var_name || ! var_value ) {
@@ -487,15 +537,8 @@ cvar_t *Cvar_Get( const char *var_name, const char *var_value, uint32_t flags, c
 	// note what types of cvars have been modified (userinfo, archive, serverinfo, systeminfo)
 	cvar_modifiedFlags |= var->flags;
 
-	hash = generateHashValue(var_name);
-	var->hashIndex = hash;
-
-	var->hashNext = hashTable[hash];
-	if(hashTable[hash])
-		hashTable[hash]->hashPrev = var;
-
-	var->hashPrev = NULL;
-	hashTable[hash] = var;
+	Cvar_HashLink( var );
+	cvar_modificationCount++;
 
 	// sort on write
 	cvar_sort = qtrue;
@@ -683,6 +726,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, uint32_t defaultFlag
 			var->latchedString = CopyString(value);
 			var->modified = qtrue;
 			var->modificationCount++;
+			cvar_modificationCount++;
 			return var;
 		}
 
@@ -706,6 +750,7 @@ cvar_t *Cvar_Set2( const char *var_name, const char *value, uint32_t defaultFlag
 
 	var->modified = qtrue;
 	var->modificationCount++;
+	cvar_modificationCount++;
 
 	Cvar_FreeString (var->string);	// free the old value string
 
@@ -1314,12 +1359,8 @@ cvar_t *Cvar_Unset(cvar_t *cv)
 	if(cv->next)
 		cv->next->prev = cv->prev;
 
-	if(cv->hashPrev)
-		cv->hashPrev->hashNext = cv->hashNext;
-	else
-		hashTable[cv->hashIndex] = cv->hashNext;
-	if(cv->hashNext)
-		cv->hashNext->hashPrev = cv->hashPrev;
+	Cvar_HashUnlink( cv );
+	cvar_modificationCount++;
 
 	memset(cv, 0, sizeof(*cv));
 
@@ -1556,6 +1597,18 @@ void	Cvar_Update( vmCvar_t *vmCvar ) {
 	vmCvar->integer = cv->integer;
 }
 
+/*
+=====================
+Cvar_ModificationCount
+
+changes whenever any cvar is created, changed or removed, modules compare it
+against the last value they saw before calling Cvar_Update on their vmCvars
+=====================
+*/
+int Cvar_ModificationCount( void ) {
+	return cvar_modificationCount;
+}
+
 /*
 ==================
 Cvar_CompleteCvarName
@@ -1583,6 +1636,7 @@ Reads in all archived cvars
 void Cvar_Init (void) {
 	memset( cvar_indexes, 0, sizeof( cvar_indexes ) );
 	memset( hashTable, 0, sizeof( hashTable ) );
+	memset( hashValues, 0, sizeof( hashValues ) );
 
 	cvar_cheats = Cvar_Get( "sv_cheats", "1", CVAR_ROM|CVAR_SYSTEMINFO, "Allow cheats on server if set to 1" );
 
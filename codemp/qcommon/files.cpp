@@ -30,10 +30,14 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
  *
  *****************************************************************************/
 
+#include <atomic>
 #include <condition_variable>
 #include <deque>
+#include <list>
 #include <mutex>
+#include <string>
 #include <thread>
+#include <unordered_map>
 #include <vector>
 
 #include "qcommon/qcommon.h"
@@ -45,6 +49,12 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #endif
 #include <minizip/unzip.h>
 
+#ifdef USE_INTERNAL_ZLIB
+#include "zlib/zlib.h"
+#else
+#include <zlib.h>
+#endif
+
 #if defined(_WIN32)
 #include <windows.h>
 #endif
@@ -60,6 +70,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include <fcntl.h>
 #endif
 
+#include <sys/stat.h>
+
 /*
 =============================================================================
 
@@ -258,6 +270,8 @@ static int			fs_readCount;			// total bytes read
 static int			fs_loadCount;			// total files read
 static int			fs_packFiles = 0;		// total number of files in packs
 
+static void FS_FlushDirMisses( void );
+
 static int			fs_fakeChkSum;
 static int			fs_checksumFeed;
 
@@ -271,19 +285,55 @@ typedef struct qfile_us {
 	qboolean	unique;
 } qfile_ut;
 
+#define FS_ASYNC_MAX_MARKS	64
+#define FS_ZIP_OUTBUF		65536
+
+// a place in the stream of an async file that a seek point should be made at
+typedef struct {
+	int			key;
+	size_t		pos;
+} fsAsyncMark_t;
+
+// seek point of a compressed file, written to the .idx next to it
+typedef struct {
+	int			key;
+	int			rawOffset;		// in the decompressed stream
+	int			zipOffset;		// in the .gz, raw deflate can be started here
+} fsSeekPoint_t;
+
+// compression state of an async file, only touched by the writer owning the handle
+typedef struct {
+	z_stream	zs;
+	int			rawOffset;
+	int			zipOffset;
+	std::vector<fsSeekPoint_t>	index;
+	byte		out[FS_ZIP_OUTBUF];
+} fsAsyncZip_t;
+
 typedef struct fileHandleData_s {
 	qfile_ut	handleFiles;
 	qboolean	handleSync;
 	qboolean	handleAsync;
-	std::thread	*writerThread;
-	std::mutex	writeLock;
+	// async writes go into a ring buffer that a pooled writer thread empties,
+	// the buffer is kept for the next async file opened with this handle
+	std::mutex	writeLock;			// only used to wait for room in the ring
 	std::condition_variable	cv;
-	std::deque<std::vector<byte> > writes;
-	qboolean	closed;
+	byte		*ring;
+	size_t		ringSize;
+	std::atomic<size_t>	ringHead;	// total bytes put in the ring
+	std::atomic<size_t>	ringTail;	// total bytes written out
+	std::atomic<bool>	queued;		// queued for or owned by a writer thread
+	std::atomic<bool>	active;		// open for async writing
+	std::atomic<bool>	closed;
+	fsAsyncZip_t		*zip;		// gzip the file on the writer thread
+	fsAsyncMark_t		marks[FS_ASYNC_MAX_MARKS];
+	std::atomic<unsigned>	markHead;
+	std::atomic<unsigned>	markTail;
 	char		ospath[MAX_OSPATH];
 	int			fileSize;
 	int			zipFilePos;
 	int			zipFileLen;
+	const fileInPack_t	*pakFile;	// pak entry the file was found as
 	qboolean	zipFile;
 	char		name[MAX_ZPATH];
 } fileHandleData_t;
@@ -333,13 +383,13 @@ static void FS_ResetFileHandleData( fileHandleData_t *f ) {
 	f->handleFiles = {};
 	f->handleSync = qfalse;
 	f->handleAsync = qfalse;
-	f->writerThread = nullptr;
-	f->writes.clear();
-	f->closed = qfalse;
+	// queued stays set so the writers leave the handle alone until it's reopened
+	f->active = false;
 	f->ospath[0] = '\0';
 	f->fileSize = 0;
 	f->zipFilePos = 0;
 	f->zipFileLen = 0;
+	f->pakFile = NULL;
 	f->zipFile = qfalse;
 	f->name[0] = '\0';
 }
@@ -442,6 +492,34 @@ void	FS_ForceFlush( fileHandle_t f ) {
 	setvbuf( file, NULL, _IONBF, 0 );
 }
 
+/*
+================
+FS_FileModificationTime
+
+Returns the modification time of an open file, the file read through the
+handle keeps it even if it is replaced on disk meanwhile. Files in paks
+report the DOS time stored for them in the zip.
+================
+*/
+int64_t FS_FileModificationTime( fileHandle_t f ) {
+	struct stat buf;
+
+	if ( f >= 1 && f < MAX_FILE_HANDLES && fsh[f].zipFile ) {
+		unz_file_info info;
+
+		if ( unzGetCurrentFileInfo( fsh[f].handleFiles.file.z, &info, NULL, 0, NULL, 0, NULL, 0 ) != UNZ_OK ) {
+			return -1;
+		}
+		return (int64_t)info.dosDate;
+	}
+
+	if ( fstat( fileno( FS_FileForHandle( f ) ), &buf ) == -1 ) {
+		return -1;
+	}
+
+	return (int64_t)buf.st_mtime;
+}
+
 /*
 ================
 FS_fplength
@@ -626,6 +704,7 @@ void FS_CopyFile( char *fromOSPath, char *toOSPath ) {
 	byte	*buf;
 
 	FS_CheckFilenameIsMutable( fromOSPath, __func__ );
+	FS_FlushDirMisses();
 
 	Com_Printf( "copy %s to %s\n", fromOSPath, toOSPath );
 
@@ -819,6 +898,7 @@ fileHandle_t FS_SV_FOpenFileWrite( const char *filename ) {
 	fileHandle_t	f;
 
 	FS_AssertInitialised();
+	FS_FlushDirMisses();
 
 	ospath = FS_BuildOSPath( fs_homepath->string, filename, "" );
 	ospath[strlen(ospath)-1] = '\0';
@@ -945,6 +1025,7 @@ void FS_SV_Rename( const char *from, const char *to, qboolean safe ) {
 	char			*from_ospath, *to_ospath;
 
 	FS_AssertInitialised();
+	FS_FlushDirMisses();
 
 	// don't let sound stutter
 	S_ClearSoundBuffer();
@@ -979,6 +1060,7 @@ void FS_Rename( const char *from, const char *to ) {
 	char			*from_ospath, *to_ospath;
 
 	FS_AssertInitialised();
+	FS_FlushDirMisses();
 
 	// don't let sound stutter
 	S_ClearSoundBuffer();
@@ -999,13 +1081,379 @@ void FS_Rename( const char *from, const char *to ) {
 	}
 }
 
+/*
+=================
+Async file writers
+
+A small pool of threads writes out the ring buffers of all async handles.
+FS_Write only copies into the ring, a handle is queued for a writer once
+enough data piled up or the file is closed, and the writers pick up what's
+left over every FS_ASYNC_FLUSH_MSEC. When a ring is full FS_Write waits for
+the writer, those stalls are counted so slow disks show up in fs_writers.
+=================
+*/
+
+#define FS_ASYNC_FLUSH_MSEC		100
+#define FS_MAX_ASYNC_WRITERS	8
+
+static cvar_t					*fs_asyncWriters;
+static cvar_t					*fs_asyncBufferSize;
+
+static std::vector<std::thread>	fs_writerThreads;
+static std::mutex				fs_writerLock;
+static std::condition_variable	fs_writerReady;
+static std::deque<fileHandle_t>	fs_writerQueue;
+static bool						fs_writerQuit;
+
+static std::atomic<int64_t>		fs_asyncBytes;		// bytes passed to FS_Write
+static std::atomic<int64_t>		fs_asyncWrites;		// fwrite calls made by the writers
+static std::atomic<int64_t>		fs_asyncStalls;		// FS_Write calls that waited for room
+static std::atomic<int64_t>		fs_asyncStallMsec;
+static size_t					fs_asyncPeakFill;	// main thread only
+
+extern void Com_PushEvent( sysEvent_t *event );
+
+static void FS_StartAsyncWriters( void );
+
+static void FS_QueueAsyncHandle( fileHandle_t h ) {
+	// the writers are stopped by FS_Shutdown, files opened before a restart come back here
+	if ( fs_writerThreads.empty() ) {
+		FS_StartAsyncWriters();
+	}
+	if ( fsh[h].queued.exchange( true ) ) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l( fs_writerLock );
+		fs_writerQueue.push_back( h );
+	}
+	fs_writerReady.notify_one();
+}
+
+static void FS_AsyncDeflate( fileHandleData_t *f, const byte *data, size_t len, int flush ) {
+	fsAsyncZip_t *zip = f->zip;
+
+	zip->zs.next_in = (Bytef *)data;
+	zip->zs.avail_in = (uInt)len;
+	do {
+		zip->zs.next_out = zip->out;
+		zip->zs.avail_out = sizeof( zip->out );
+		deflate( &zip->zs, flush );
+
+		size_t out = sizeof( zip->out ) - zip->zs.avail_out;
+		if ( out ) {
+			fwrite( zip->out, 1, out, f->handleFiles.file.o );
+			fs_asyncWrites++;
+			zip->zipOffset += (int)out;
+		}
+	} while ( zip->zs.avail_out == 0 );
+	zip->rawOffset += (int)len;
+}
+
+// writes out the ring between the stream positions from and to
+static void FS_AsyncOutputRange( fileHandleData_t *f, size_t from, size_t to ) {
+	size_t len = to - from;
+	size_t start = from % f->ringSize;
+	size_t first = Q_min( len, f->ringSize - start );
+
+	if ( !len ) {
+		return;
+	}
+
+	if ( f->zip ) {
+		FS_AsyncDeflate( f, f->ring + start, first, Z_NO_FLUSH );
+		if ( len > first ) {
+			FS_AsyncDeflate( f, f->ring, len - first, Z_NO_FLUSH );
+		}
+		return;
+	}
+
+	fwrite( f->ring + start, 1, first, f->handleFiles.file.o );
+	fs_asyncWrites++;
+	if ( len > first ) {
+		fwrite( f->ring, 1, len - first, f->handleFiles.file.o );
+		fs_asyncWrites++;
+	}
+}
+
+// resets the deflate dictionary so decompression can start here
+static void FS_AsyncSeekPoint( fileHandleData_t *f, int key ) {
+	fsAsyncZip_t *zip = f->zip;
+	fsSeekPoint_t point;
+
+	if ( zip->rawOffset ) {
+		FS_AsyncDeflate( f, NULL, 0, Z_FULL_FLUSH );
+	}
+
+	point.key = key;
+	point.rawOffset = zip->rawOffset;
+	// the gzip header isn't out before the first deflate call, raw deflate starts after it anyway
+	point.zipOffset = zip->rawOffset ? zip->zipOffset : -1;
+	zip->index.push_back( point );
+}
+
+/*
+The index next to a compressed file:
+
+4	FS_SEEKINDEX_IDENT
+4	FS_SEEKINDEX_VERSION
+4	number of seek points
+<seek points>	key, offset in the decompressed data, offset of the deflate data
+				in the .gz (-1 for the start of the file)
+*/
+#define FS_SEEKINDEX_IDENT		(('X'<<24)+('I'<<16)+('Z'<<8)+'S')
+#define FS_SEEKINDEX_VERSION	1
+
+static void FS_AsyncFinishZip( fileHandleData_t *f ) {
+	fsAsyncZip_t *zip = f->zip;
+	char indexPath[MAX_OSPATH];
+	FILE *index;
+
+	FS_AsyncDeflate( f, NULL, 0, Z_FINISH );
+	deflateEnd( &zip->zs );
+
+	Com_sprintf( indexPath, sizeof( indexPath ), "%s.idx", f->ospath );
+	index = fopen( indexPath, "wb" );
+	if ( !index ) {
+		return;
+	}
+
+	int header[3] = { LittleLong( FS_SEEKINDEX_IDENT ), LittleLong( FS_SEEKINDEX_VERSION ), LittleLong( (int)zip->index.size() ) };
+	fwrite( header, sizeof( header ), 1, index );
+	for ( const fsSeekPoint_t &point : zip->index ) {
+		int entry[3] = { LittleLong( point.key ), LittleLong( point.rawOffset ), LittleLong( point.zipOffset ) };
+		fwrite( entry, sizeof( entry ), 1, index );
+	}
+	fclose( index );
+}
+
+// called by the writer owning the handle
+static void FS_ServiceAsyncHandle( fileHandle_t h ) {
+	fileHandleData_t *f = &fsh[h];
+
+	while ( 1 ) {
+		size_t tail = f->ringTail.load();
+		size_t head = f->ringHead.load();
+
+		if ( head != tail ) {
+			if ( f->handleFiles.file.o ) {
+				size_t pos = tail;
+
+				// seek points that are in the data, marks past it wait for the next round
+				while ( f->zip && f->markTail.load() != f->markHead.load() ) {
+					fsAsyncMark_t *mark = &f->marks[f->markTail.load() % FS_ASYNC_MAX_MARKS];
+					if ( mark->pos > head ) {
+						break;
+					}
+					FS_AsyncOutputRange( f, pos, mark->pos );
+					pos = mark->pos;
+					FS_AsyncSeekPoint( f, mark->key );
+					f->markTail++;
+				}
+				FS_AsyncOutputRange( f, pos, head );
+			}
+			{
+				std::lock_guard<std::mutex> l( f->writeLock );
+				f->ringTail.store( head );
+			}
+			f->cv.notify_one();
+			continue;
+		}
+
+		if ( f->closed.load() ) {
+			// closed is set after the last write, so look once more
+			if ( f->ringHead.load() != tail ) {
+				continue;
+			}
+			if ( f->handleFiles.file.o ) {
+				if ( f->zip ) {
+					FS_AsyncFinishZip( f );
+				}
+				fclose( f->handleFiles.file.o );
+			}
+			// the handle stays queued until the main thread resets it
+			sysEvent_t event;
+			Com_Memset( &event, 0, sizeof( event ) );
+			event.evType = SE_AIO_FCLOSE;
+			event.evValue = h;
+			Com_PushEvent( &event );
+			return;
+		}
+
+		f->queued.store( false );
+		// something may have come in after the last look, take the handle
+		// back unless FS_Write already queued it again
+		if ( f->ringHead.load() == tail && !f->closed.load() ) {
+			return;
+		}
+		if ( f->queued.exchange( true ) ) {
+			return;
+		}
+	}
+}
+
+static void FS_AsyncWriterThread( void ) {
+	while ( 1 ) {
+		fileHandle_t h = 0;
+		bool quit;
+		{
+			std::unique_lock<std::mutex> l( fs_writerLock );
+			if ( fs_writerQueue.empty() && !fs_writerQuit ) {
+				fs_writerReady.wait_for( l, std::chrono::milliseconds( FS_ASYNC_FLUSH_MSEC ) );
+			}
+			if ( !fs_writerQueue.empty() ) {
+				h = fs_writerQueue.front();
+				fs_writerQueue.pop_front();
+			}
+			quit = fs_writerQuit;
+		}
+
+		if ( h ) {
+			FS_ServiceAsyncHandle( h );
+			continue;
+		}
+
+		// write out whatever is sitting in the rings
+		for ( int i = 1; i < MAX_FILE_HANDLES; i++ ) {
+			if ( !fsh[i].active.load() ) {
+				continue;
+			}
+			if ( fsh[i].ringHead.load() == fsh[i].ringTail.load() && !fsh[i].closed.load() ) {
+				continue;
+			}
+			if ( fsh[i].queued.exchange( true ) ) {
+				continue;
+			}
+			FS_ServiceAsyncHandle( i );
+		}
+
+		if ( quit ) {
+			break;
+		}
+	}
+}
+
+static void FS_StartAsyncWriters( void ) {
+	int numWriters = Com_Clampi( 1, FS_MAX_ASYNC_WRITERS, fs_asyncWriters->integer );
+
+	fs_writerQuit = false;
+	for ( int i = 0; i < numWriters; i++ ) {
+		fs_writerThreads.emplace_back( FS_AsyncWriterThread );
+	}
+}
+
+// writes out everything queued so far and stops the writers, they're started again
+// by the next FS_FOpenFileWriteAsync
+static void FS_StopAsyncWriters( void ) {
+	if ( fs_writerThreads.empty() ) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l( fs_writerLock );
+		fs_writerQuit = true;
+	}
+	fs_writerReady.notify_all();
+	for ( std::thread &t : fs_writerThreads ) {
+		t.join();
+	}
+	fs_writerThreads.clear();
+}
+
+static void FS_AsyncWrite( fileHandle_t h, const byte *buf, int len ) {
+	fileHandleData_t *f = &fsh[h];
+	size_t remaining = len;
+
+	if ( fs_writerThreads.empty() ) {
+		FS_StartAsyncWriters();
+	}
+	fs_asyncBytes += len;
+	while ( remaining ) {
+		size_t head = f->ringHead.load();
+		size_t tail = f->ringTail.load();
+		size_t room = f->ringSize - ( head - tail );
+
+		if ( !room ) {
+			// the disk fell behind, wait for the writer
+			int start = Sys_Milliseconds();
+			FS_QueueAsyncHandle( h );
+			{
+				std::unique_lock<std::mutex> l( f->writeLock );
+				f->cv.wait( l, [f, tail] { return f->ringTail.load() != tail; } );
+			}
+			fs_asyncStalls++;
+			fs_asyncStallMsec += Sys_Milliseconds() - start;
+			continue;
+		}
+
+		size_t n = Q_min( room, remaining );
+		size_t start = head % f->ringSize;
+		size_t first = Q_min( n, f->ringSize - start );
+
+		memcpy( f->ring + start, buf, first );
+		if ( n > first ) {
+			memcpy( f->ring, buf + first, n - first );
+		}
+		f->ringHead.store( head + n );
+		buf += n;
+		remaining -= n;
+
+		fs_asyncPeakFill = Q_max( fs_asyncPeakFill, head + n - tail );
+	}
+
+	// small writes pile up until a writer gets a big chunk out of them
+	if ( f->ringHead.load() - f->ringTail.load() >= f->ringSize / 4 ) {
+		FS_QueueAsyncHandle( h );
+	}
+}
+
+// waits until a writer got everything written so far out, the writers don't
+// buffer so it's in the file then
+#define FS_ASYNC_FLUSH_TIMEOUT	2000
+
+static void FS_FlushAsync( fileHandle_t h ) {
+	fileHandleData_t *f = &fsh[h];
+	size_t target = f->ringHead.load();
+	int start = Sys_Milliseconds();
+
+	if ( f->ringTail.load() == target ) {
+		return;
+	}
+
+	FS_QueueAsyncHandle( h );
+
+	std::unique_lock<std::mutex> l( f->writeLock );
+	while ( f->ringTail.load() < target && Sys_Milliseconds() - start < FS_ASYNC_FLUSH_TIMEOUT ) {
+		// another thread might be waiting for room as well, don't rely on being the one notified
+		f->cv.wait_for( l, std::chrono::milliseconds( 10 ) );
+	}
+}
+
+static void FS_Writers_f( void ) {
+	int64_t writes = fs_asyncWrites.load();
+	int open = 0;
+
+	for ( int i = 1; i < MAX_FILE_HANDLES; i++ ) {
+		if ( fsh[i].active.load() ) {
+			open++;
+		}
+	}
+
+	Com_Printf( "%d writer threads, %d async files open\n", (int)fs_writerThreads.size(), open );
+	Com_Printf( "%lld KB written in %lld writes (%lld bytes on average)\n", (long long)( fs_asyncBytes.load() >> 10 ),
+		(long long)writes, (long long)( writes ? fs_asyncBytes.load() / writes : 0 ) );
+	Com_Printf( "%lld stalls on full buffers, %lld msec spent waiting\n", (long long)fs_asyncStalls.load(), (long long)fs_asyncStallMsec.load() );
+	Com_Printf( "peak buffer fill %d KB\n", (int)( fs_asyncPeakFill >> 10 ) );
+}
+
 void FS_FCloseAio( int handle ) {
 	fileHandle_t f = (fileHandle_t) handle;
 	if ( f < 1 || f >= MAX_FILE_HANDLES ) {
 		Com_Error( ERR_FATAL, "FCloseAio called with invalid handle %d\n", f );
 	}
-	fsh[f].writerThread->join();
-	delete fsh[f].writerThread;
+	if ( fsh[f].zip ) {
+		delete fsh[f].zip;
+		fsh[f].zip = NULL;
+	}
 	FS_ResetFileHandleData( &fsh[f] );
 }
 
@@ -1040,69 +1488,128 @@ void FS_FCloseFile( fileHandle_t f ) {
 		return;
 	}
 
+	if ( fsh[f].handleAsync ) {
+		// queue the file to be closed after all pending operations are completed.
+		fsh[f].closed = true;
+		// the writer may create <filename>.idx as well
+		FS_FlushDirMisses();
+		FS_QueueAsyncHandle( f );
+		return;
+	}
+
 	// we didn't find it as a pak, so close it as a unique file
 	if (fsh[f].handleFiles.file.o) {
-		if ( fsh[f].handleAsync ) {
-			// queue the file to be closed after all pending operations are completed.
-			{
-				std::lock_guard<std::mutex> l( fsh[f].writeLock );
-				fsh[f].closed = qtrue;
-			}
-			fsh[f].cv.notify_one();
-			return;
-		} else {
-			fclose (fsh[f].handleFiles.file.o);
-		}
+		fclose (fsh[f].handleFiles.file.o);
 	}
 	FS_ResetFileHandleData( &fsh[f] );
 }
 
-extern void Com_PushEvent( sysEvent_t *event );
-void FS_AsyncWriterThread( fileHandle_t h ) {
-	fileHandleData_t *f = &fsh[h];
-	if ( !FS_CreatePath( f->ospath ) ) {
-		f->handleFiles.file.o = fopen( f->ospath, "wb" );
+static fileHandle_t FS_OpenAsync( const char *filename, qboolean compress ) {
+	fileHandle_t f = FS_HandleForFile();
+	fileHandleData_t *fh = &fsh[f];
+	size_t ringSize = (size_t)Com_Clampi( 16, 16384, fs_asyncBufferSize->integer ) << 10;
+
+	FS_FlushDirMisses();
+
+	Q_strncpyz(fh->ospath, FS_BuildOSPath( fs_homepath->string, fs_gamedir, filename ), MAX_OSPATH );
+
+	if ( fs_debug->integer ) {
+		Com_Printf( "FS_FOpenFileWriteAsync: %s\n", fh->ospath );
 	}
-	if ( f->handleFiles.file.o == nullptr ) {
-		Com_Printf( "Warning: failed to open file %s\n", f->name );
-		return;
+
+	Q_strncpyz( fh->name, filename, sizeof( fh->name ) );
+
+	// the file is opened here so writers never touch the search paths or print
+	if ( !FS_CreatePath( fh->ospath ) ) {
+		fh->handleFiles.file.o = fopen( fh->ospath, "wb" );
 	}
-	while ( qtrue ) {
-		std::vector<byte> write;
-		{
-			std::unique_lock<std::mutex> l( f->writeLock );
-			while ( f->writes.empty() && !f->closed ) {
-				f->cv.wait( l );
-			}
-			if ( f->closed && f->writes.empty() ) {
-				break;
-			}
-			write = std::move(f->writes.front());
-			f->writes.pop_front();
+	if ( !fh->handleFiles.file.o ) {
+		Com_Printf( "Warning: failed to open file %s\n", fh->name );
+		FS_ResetFileHandleData( fh );
+		return 0;
+	}
+	// the writers hand over big chunks already
+	setvbuf( fh->handleFiles.file.o, NULL, _IONBF, 0 );
+
+	if ( fh->ringSize != ringSize ) {
+		if ( fh->ring ) {
+			Z_Free( fh->ring );
+		}
+		fh->ring = (byte *)Z_Malloc( ringSize, TAG_FILESYS, qfalse );
+		fh->ringSize = ringSize;
+	}
+	fh->ringHead = 0;
+	fh->ringTail = 0;
+	fh->markHead = 0;
+	fh->markTail = 0;
+
+	if ( compress ) {
+		fh->zip = new fsAsyncZip_t;
+		Com_Memset( &fh->zip->zs, 0, sizeof( fh->zip->zs ) );
+		fh->zip->rawOffset = 0;
+		fh->zip->zipOffset = 0;
+		// gzip wrapper so the file can be unpacked with any tool
+		if ( deflateInit2( &fh->zip->zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+			Com_Printf( "Warning: couldn't compress %s\n", fh->name );
+			delete fh->zip;
+			fh->zip = NULL;
 		}
-		fwrite( &write[0], 1, write.size(), f->handleFiles.file.o );
 	}
-	fclose( f->handleFiles.file.o );
-	sysEvent_t event;
-	Com_Memset( &event, 0, sizeof( event ) );
-	event.evType = SE_AIO_FCLOSE;
-	event.evValue = h;
-	Com_PushEvent( &event );
+
+	fh->closed = false;
+	fh->queued = false;
+	fh->handleAsync = qtrue;
+	fh->active = true;
+
+	if ( fs_writerThreads.empty() ) {
+		FS_StartAsyncWriters();
+	}
+	return f;
 }
 
 fileHandle_t FS_FOpenFileWriteAsync( const char *filename, qboolean safe ) {
-	fileHandle_t f = FS_HandleForFile();
-	Q_strncpyz(fsh[f].ospath, FS_BuildOSPath( fs_homepath->string, fs_gamedir, filename ), MAX_OSPATH );
+	return FS_OpenAsync( filename, qfalse );
+}
 
-	if ( fs_debug->integer ) {
-		Com_Printf( "FS_FOpenFileWriteAsync: %s\n", fsh[f].ospath );
+/*
+===========
+FS_FOpenFileWriteCompressed
+
+Like FS_FOpenFileWriteAsync, but the writer thread gzips the data and
+writes a seek index to <filename>.idx when the file is closed.
+===========
+*/
+fileHandle_t FS_FOpenFileWriteCompressed( const char *filename, qboolean safe ) {
+	return FS_OpenAsync( filename, qtrue );
+}
+
+/*
+===========
+FS_AsyncMark
+
+Makes a seek point at the current end of a compressed file, key is
+stored with it in the index (e.g. the server time). Does nothing for
+other files.
+===========
+*/
+void FS_AsyncMark( fileHandle_t f, int key ) {
+	fileHandleData_t *fh;
+
+	if ( f < 1 || f >= MAX_FILE_HANDLES ) {
+		return;
+	}
+	fh = &fsh[f];
+	if ( !fh->handleAsync || !fh->zip ) {
+		return;
 	}
 
-	Q_strncpyz( fsh[f].name, filename, sizeof( fsh[f].name ) );
-	fsh[f].handleAsync = qtrue;
-	// spawn writer thread
-	fsh[f].writerThread = new std::thread( FS_AsyncWriterThread, f );
-	return f;
+	unsigned head = fh->markHead.load();
+	if ( head - fh->markTail.load() >= FS_ASYNC_MAX_MARKS ) {
+		return;	// writer is behind, the index just gets a bit sparser
+	}
+	fh->marks[head % FS_ASYNC_MAX_MARKS].key = key;
+	fh->marks[head % FS_ASYNC_MAX_MARKS].pos = fh->ringHead.load();
+	fh->markHead.store( head + 1 );
 }
 
 /*
@@ -1116,6 +1623,7 @@ fileHandle_t FS_FOpenFileWrite( const char *filename, qboolean safe ) {
 	fileHandle_t	f;
 
 	FS_AssertInitialised();
+	FS_FlushDirMisses();
 
 	f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
@@ -1160,6 +1668,7 @@ fileHandle_t FS_FOpenFileAppend( const char *filename ) {
 	fileHandle_t	f;
 
 	FS_AssertInitialised();
+	FS_FlushDirMisses();
 
 	f = FS_HandleForFile();
 	fsh[f].zipFile = qfalse;
@@ -1351,6 +1860,192 @@ bool FS_FileCacheable(const char* const filename)
 	return( strchr(filename, '/') != 0 );
 }
 
+/*
+=================
+File index
+
+The entries of every pak in the search path are merged into one hash table, so
+finding a file costs one probe instead of one per pak. Entries with the same
+name are chained in search order and directories are merged in by their
+position in the search path, FS_FOpenFileRead still applies the pure and
+config file rules to each of them. Misses in directories are remembered for
+FS_DIR_MISS_MSEC or until the filesystem writes a file, so optional assets
+that don't exist don't cost an fopen per directory on every lookup.
+=================
+*/
+
+#define FS_DIR_MISS_MSEC	5000
+#define FS_MAX_MISS_DIRS	64
+
+typedef struct {
+	unsigned int	hash;
+	int				order;			// position in fs_searchpaths
+	searchpath_t	*search;
+	fileInPack_t	*file;
+	int				next;			// next entry in the bucket, in search order
+} fileIndexEntry_t;
+
+typedef struct {
+	const char		*name;
+	unsigned int	hash;
+	int				entry;
+	int				dir;			// next directory in fs_indexDirs
+} fileIndexIter_t;
+
+static std::vector<fileIndexEntry_t>	fs_indexEntries;
+static std::vector<int>					fs_indexBuckets;
+static std::vector<searchpath_t *>		fs_indexDirs;
+static std::vector<int>					fs_indexDirOrder;
+
+static std::unordered_map<std::string, uint64_t>	fs_dirMisses;	// bit per fs_indexDirs entry
+static int								fs_dirMissTime;
+
+// case and separator insensitive like FS_FilenameCompare
+static unsigned int FS_IndexHash( const char *fname ) {
+	unsigned int hash = 2166136261u;
+
+	for ( ; *fname; fname++ ) {
+		int c = *fname;
+
+		if ( c >= 'a' && c <= 'z' ) {
+			c -= ( 'a' - 'A' );
+		}
+		if ( c == '\\' || c == ':' ) {
+			c = '/';
+		}
+		hash = ( hash ^ (unsigned int)c ) * 16777619u;
+	}
+
+	return hash;
+}
+
+static void FS_ClearFileIndex( void ) {
+	fs_indexEntries.clear();
+	fs_indexBuckets.clear();
+	fs_indexDirs.clear();
+	fs_indexDirOrder.clear();
+	fs_dirMisses.clear();
+}
+
+static void FS_FlushDirMisses( void ) {
+	fs_dirMisses.clear();
+}
+
+static void FS_BuildFileIndex( void ) {
+	std::vector<searchpath_t *>	paths;
+	size_t						numEntries = 0;
+	size_t						numBuckets = 16;
+
+	FS_ClearFileIndex();
+
+	for ( searchpath_t *search = fs_searchpaths; search; search = search->next ) {
+		paths.push_back( search );
+		if ( search->pack ) {
+			numEntries += search->pack->numfiles;
+		} else if ( search->dir ) {
+			fs_indexDirs.push_back( search );
+			fs_indexDirOrder.push_back( (int)paths.size() - 1 );
+		}
+	}
+
+	while ( numBuckets < numEntries * 2 ) {
+		numBuckets <<= 1;
+	}
+	fs_indexBuckets.assign( numBuckets, -1 );
+	fs_indexEntries.reserve( numEntries );
+
+	// insert from the back so every chain ends up in search order
+	for ( int i = (int)paths.size() - 1; i >= 0; i-- ) {
+		pack_t *pak = paths[i]->pack;
+
+		if ( !pak ) {
+			continue;
+		}
+		for ( int j = 0; j < pak->numfiles; j++ ) {
+			fileInPack_t *file = &pak->buildBuffer[j];
+			fileIndexEntry_t entry;
+
+			if ( !file->name ) {
+				continue;	// the zip directory ended early
+			}
+			entry.hash = FS_IndexHash( file->name );
+			entry.order = i;
+			entry.search = paths[i];
+			entry.file = file;
+			entry.next = fs_indexBuckets[entry.hash & ( numBuckets - 1 )];
+			fs_indexBuckets[entry.hash & ( numBuckets - 1 )] = (int)fs_indexEntries.size();
+			fs_indexEntries.push_back( entry );
+		}
+	}
+}
+
+static void FS_IndexFind( const char *filename, fileIndexIter_t *it ) {
+	if ( fs_indexBuckets.empty() ) {
+		FS_BuildFileIndex();
+	}
+
+	it->name = filename;
+	it->hash = FS_IndexHash( filename );
+	it->entry = fs_indexBuckets[it->hash & ( fs_indexBuckets.size() - 1 )];
+	it->dir = 0;
+}
+
+/*
+=================
+FS_IndexNext
+
+Returns the next search path that may hold the file looked up with
+FS_IndexFind, in search order. *pakFile is set for paks, directories
+still have to be checked.
+=================
+*/
+static searchpath_t *FS_IndexNext( fileIndexIter_t *it, fileInPack_t **pakFile ) {
+	const fileIndexEntry_t *e = NULL;
+
+	while ( it->entry >= 0 ) {
+		e = &fs_indexEntries[it->entry];
+		if ( e->hash == it->hash && !FS_FilenameCompare( e->file->name, it->name ) ) {
+			break;
+		}
+		it->entry = e->next;
+		e = NULL;
+	}
+
+	if ( it->dir < (int)fs_indexDirs.size() && ( !e || fs_indexDirOrder[it->dir] < e->order ) ) {
+		*pakFile = NULL;
+		return fs_indexDirs[it->dir++];
+	}
+
+	if ( e ) {
+		it->entry = e->next;
+		*pakFile = e->file;
+		return e->search;
+	}
+
+	return NULL;
+}
+
+static bool FS_DirMissed( const char *filename, int dir ) {
+	int now = Sys_Milliseconds();
+
+	if ( now - fs_dirMissTime > FS_DIR_MISS_MSEC ) {
+		fs_dirMisses.clear();
+		fs_dirMissTime = now;
+	}
+	if ( dir >= FS_MAX_MISS_DIRS ) {
+		return false;
+	}
+
+	auto it = fs_dirMisses.find( filename );
+	return it != fs_dirMisses.end() && ( it->second & ( 1ull << dir ) );
+}
+
+static void FS_AddDirMiss( const char *filename, int dir ) {
+	if ( dir < FS_MAX_MISS_DIRS ) {
+		fs_dirMisses[filename] |= 1ull << dir;
+	}
+}
+
 /*
 ===========
 FS_FOpenFileRead
@@ -1369,14 +2064,11 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	pack_t			*pak;
 	fileInPack_t	*pakFile;
 	directory_t		*dir;
-	long			hash;
 	//unz_s			*zfi;
 	//void			*temp;
 	int				l;
 	bool			isUserConfig = false;
 
-	hash = 0;
-
 	FS_AssertInitialised();
 
 	if ( file == NULL ) {
@@ -1427,13 +2119,12 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 	{
 		bFasterToReOpenUsingNewLocalFile = qfalse;
 
-		for ( search = fs_searchpaths ; search ; search = search->next ) {
-			//
-			if ( search->pack ) {
-				hash = FS_HashFileName(filename, search->pack->hashSize);
-			}
+		fileIndexIter_t it;
+
+		FS_IndexFind( filename, &it );
+		while ( ( search = FS_IndexNext( &it, &pakFile ) ) != NULL ) {
 			// is the element a pak file?
-			if ( search->pack && search->pack->hashTable[hash] ) {
+			if ( pakFile ) {
 				// disregard if it doesn't match one of the allowed pure pak files
 				if ( !FS_PakIsPure(search->pack) ) {
 					continue;
@@ -1444,115 +2135,109 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 					continue;
 				}
 
-				// look through all the pak file elements
 				pak = search->pack;
-				pakFile = pak->hashTable[hash];
-				do {
-					// case and separator insensitive comparisons
-					if ( !FS_FilenameCompare( pakFile->name, filename ) ) {
-						// found it!
 
-						// mark the pak as having been referenced and mark specifics on cgame and ui
-						// shaders, txt, arena files  by themselves do not count as a reference as
-						// these are loaded from all pk3s
-						// from every pk3 file..
-
-						// The x86.dll suffixes are needed in order for sv_pure to continue to
-						// work on non-x86/windows systems...
-
-						l = strlen( filename );
-						if ( !(pak->referenced & FS_GENERAL_REF)) {
-							if( !FS_IsExt(filename, ".shader", l) &&
-							    !FS_IsExt(filename, ".txt", l) &&
-							    !FS_IsExt(filename, ".str", l) &&
-							    !FS_IsExt(filename, ".cfg", l) &&
-							    !FS_IsExt(filename, ".config", l) &&
-							    !FS_IsExt(filename, ".bot", l) &&
-							    !FS_IsExt(filename, ".arena", l) &&
-							    !FS_IsExt(filename, ".menu", l) &&
-							    !FS_IsExt(filename, ".fcf", l) &&
-							    Q_stricmp(filename, "jampgamex86.dll") != 0 &&
-							    //Q_stricmp(filename, "vm/qagame.qvm") != 0 &&
-							    !strstr(filename, "levelshots") &&
-							    (FS_IsExt(filename, ".bsp", l) || FS_idPak(pak->pakFilename, "base")))
-							{
-								// hack to work around issue of com_logfile set and this being first thing logged
-								fsh[*file].handleFiles.file.z = (unzFile) -1;
-								Com_Printf("Referencing %s due to file %s opened\n", pak->pakFilename, filename);
-								fsh[*file].handleFiles.file.z = (unzFile) 0;
-								pak->referenced |= FS_GENERAL_REF;
-							}
-						}
+				// found it!
 
-						if (!(pak->referenced & FS_CGAME_REF))
-						{
-							if ( Q_stricmp( filename, "cgame.qvm" ) == 0 ||
-									Q_stricmp( filename, "cgamex86.dll" ) == 0 )
-							{
-								pak->referenced |= FS_CGAME_REF;
-							}
-						}
+				// mark the pak as having been referenced and mark specifics on cgame and ui
+				// shaders, txt, arena files  by themselves do not count as a reference as
+				// these are loaded from all pk3s
+				// from every pk3 file..
+
+				// The x86.dll suffixes are needed in order for sv_pure to continue to
+				// work on non-x86/windows systems...
+
+				l = strlen( filename );
+				if ( !(pak->referenced & FS_GENERAL_REF)) {
+					if( !FS_IsExt(filename, ".shader", l) &&
+					    !FS_IsExt(filename, ".txt", l) &&
+					    !FS_IsExt(filename, ".str", l) &&
+					    !FS_IsExt(filename, ".cfg", l) &&
+					    !FS_IsExt(filename, ".config", l) &&
+					    !FS_IsExt(filename, ".bot", l) &&
+					    !FS_IsExt(filename, ".arena", l) &&
+					    !FS_IsExt(filename, ".menu", l) &&
+					    !FS_IsExt(filename, ".fcf", l) &&
+					    Q_stricmp(filename, "jampgamex86.dll") != 0 &&
+					    //Q_stricmp(filename, "vm/qagame.qvm") != 0 &&
+					    !strstr(filename, "levelshots") &&
+					    (FS_IsExt(filename, ".bsp", l) || FS_idPak(pak->pakFilename, "base")))
+					{
+						// hack to work around issue of com_logfile set and this being first thing logged
+						fsh[*file].handleFiles.file.z = (unzFile) -1;
+						Com_Printf("Referencing %s due to file %s opened\n", pak->pakFilename, filename);
+						fsh[*file].handleFiles.file.z = (unzFile) 0;
+						pak->referenced |= FS_GENERAL_REF;
+					}
+				}
+
+				if (!(pak->referenced & FS_CGAME_REF))
+				{
+					if ( Q_stricmp( filename, "cgame.qvm" ) == 0 ||
+							Q_stricmp( filename, "cgamex86.dll" ) == 0 )
+					{
+						pak->referenced |= FS_CGAME_REF;
+					}
+				}
 
-						if (!(pak->referenced & FS_UI_REF))
-						{
-							if ( Q_stricmp( filename, "ui.qvm" ) == 0 ||
-									Q_stricmp( filename, "uix86.dll" ) == 0 )
-							{
-								pak->referenced |= FS_UI_REF;
-							}
-						}
+				if (!(pak->referenced & FS_UI_REF))
+				{
+					if ( Q_stricmp( filename, "ui.qvm" ) == 0 ||
+							Q_stricmp( filename, "uix86.dll" ) == 0 )
+					{
+						pak->referenced |= FS_UI_REF;
+					}
+				}
 
-						if ( uniqueFILE ) {
-							// open a new file on the pakfile
-							fsh[*file].handleFiles.file.z = unzOpen (pak->pakFilename);
-							if (fsh[*file].handleFiles.file.z == NULL) {
-								Com_Error (ERR_FATAL, "Couldn't open %s", pak->pakFilename);
-							}
-						} else {
-							fsh[*file].handleFiles.file.z = pak->handle;
-						}
-						Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
-						fsh[*file].zipFile = qtrue;
+				if ( uniqueFILE ) {
+					// open a new file on the pakfile
+					fsh[*file].handleFiles.file.z = unzOpen (pak->pakFilename);
+					if (fsh[*file].handleFiles.file.z == NULL) {
+						Com_Error (ERR_FATAL, "Couldn't open %s", pak->pakFilename);
+					}
+				} else {
+					fsh[*file].handleFiles.file.z = pak->handle;
+				}
+				Q_strncpyz( fsh[*file].name, filename, sizeof( fsh[*file].name ) );
+				fsh[*file].zipFile = qtrue;
 
-						// set the file position in the zip file (also sets the current file info)
-						unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
+				// set the file position in the zip file (also sets the current file info)
+				unzSetOffset(fsh[*file].handleFiles.file.z, pakFile->pos);
 
-						// open the file in the zip
-						unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
+				// open the file in the zip
+				unzOpenCurrentFile(fsh[*file].handleFiles.file.z);
 
 #if 0
-						zfi = (unz_s *)fsh[*file].handleFiles.file.z;
-						// in case the file was new
-						temp = zfi->filestream;
-						// set the file position in the zip file (also sets the current file info)
-						unzSetOffset(pak->handle, pakFile->pos);
-						// copy the file info into the unzip structure
-						Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
-						// we copy this back into the structure
-						zfi->filestream = temp;
-						// open the file in the zip
-						unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
+				zfi = (unz_s *)fsh[*file].handleFiles.file.z;
+				// in case the file was new
+				temp = zfi->filestream;
+				// set the file position in the zip file (also sets the current file info)
+				unzSetOffset(pak->handle, pakFile->pos);
+				// copy the file info into the unzip structure
+				Com_Memcpy( zfi, pak->handle, sizeof(unz_s) );
+				// we copy this back into the structure
+				zfi->filestream = temp;
+				// open the file in the zip
+				unzOpenCurrentFile( fsh[*file].handleFiles.file.z );
 #endif
-						fsh[*file].zipFilePos = pakFile->pos;
-						fsh[*file].zipFileLen = pakFile->len;
+				fsh[*file].zipFilePos = pakFile->pos;
+				fsh[*file].zipFileLen = pakFile->len;
+				fsh[*file].pakFile = pakFile;
 
-						if ( fs_debug->integer ) {
-							Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n",
-								filename, pak->pakFilename );
-						}
+				if ( fs_debug->integer ) {
+					Com_Printf( "FS_FOpenFileRead: %s (found in '%s')\n",
+						filename, pak->pakFilename );
+				}
 	#ifndef DEDICATED
 	#ifndef FINAL_BUILD
-						// Check for unprecached files when in game but not in the menus
-						if((cls.state == CA_ACTIVE) && !(Key_GetCatcher( ) & KEYCATCH_UI))
-						{
-							Com_Printf(S_COLOR_YELLOW "WARNING: File %s not precached\n", filename);
-						}
+				// Check for unprecached files when in game but not in the menus
+				if((cls.state == CA_ACTIVE) && !(Key_GetCatcher( ) & KEYCATCH_UI))
+				{
+					Com_Printf(S_COLOR_YELLOW "WARNING: File %s not precached\n", filename);
+				}
 	#endif
 	#endif // DEDICATED
-						return pakFile->len;
-					}
-					pakFile = pakFile->next;
-				} while(pakFile != NULL);
+				return pakFile->len;
 			} else if ( search->dir ) {
 				// check a file in the directory tree
 
@@ -1577,9 +2262,14 @@ long FS_FOpenFileRead( const char *filename, fileHandle_t *file, qboolean unique
 
 				dir = search->dir;
 
+				if ( FS_DirMissed( filename, it.dir - 1 ) ) {
+					continue;
+				}
+
 				netpath = FS_BuildOSPath( dir->path, dir->gamedir, filename );
 				fsh[*file].handleFiles.file.o = fopen (netpath, "rb");
 				if ( !fsh[*file].handleFiles.file.o ) {
+					FS_AddDirMiss( filename, it.dir - 1 );
 					continue;
 				}
 
@@ -1790,11 +2480,7 @@ int FS_Write( const void *buffer, int len, fileHandle_t h ) {
 	buf = (byte *)buffer;
 
 	if ( fsh[h].handleAsync ) {
-		{
-			std::lock_guard<std::mutex> l( fsh[h].writeLock );
-			fsh[h].writes.emplace_back( buf, buf + len );
-		}
-		fsh[h].cv.notify_one();
+		FS_AsyncWrite( h, buf, len );
 		return len;
 	} else {
 		f = FS_FileForHandle( h );
@@ -1999,6 +2685,92 @@ int	FS_FileIsInPAK(const char *filename, int *pChecksum ) {
 	return -1;
 }
 
+/*
+=================
+Read cache
+
+FS_ReadFile keeps the inflated contents of files read from paks, keyed by the
+pak entry the lookup settled on, so assets that are parsed again on every map
+load (saber, vehicle and NPC files, animation configs, scripts) skip minizip.
+The least recently used files are dropped once fs_readCacheSize KB is used.
+Callers own and may modify the buffer FS_ReadFile returns, so hits are copied
+out of the cache rather than shared.
+=================
+*/
+
+typedef struct {
+	const fileInPack_t	*file;
+	std::vector<byte>	data;
+} readCacheEntry_t;
+
+static cvar_t			*fs_readCacheSize;
+
+static std::list<readCacheEntry_t>	fs_readCacheLRU;	// most recently used first
+static std::unordered_map<const fileInPack_t *, std::list<readCacheEntry_t>::iterator>	fs_readCache;
+static size_t			fs_readCacheBytes;
+
+static struct {
+	int		hits;
+	int		misses;
+	int64_t	bytesSaved;		// inflated bytes served from the cache
+} fs_readCacheStats;
+
+static void FS_ClearReadCache( void ) {
+	fs_readCache.clear();
+	fs_readCacheLRU.clear();
+	fs_readCacheBytes = 0;
+}
+
+static void FS_TrimReadCache( size_t budget ) {
+	while ( fs_readCacheBytes > budget && !fs_readCacheLRU.empty() ) {
+		readCacheEntry_t &entry = fs_readCacheLRU.back();
+
+		fs_readCacheBytes -= entry.data.size();
+		fs_readCache.erase( entry.file );
+		fs_readCacheLRU.pop_back();
+	}
+}
+
+static const readCacheEntry_t *FS_FindReadCache( const fileInPack_t *file ) {
+	auto it = fs_readCache.find( file );
+
+	if ( it == fs_readCache.end() ) {
+		fs_readCacheStats.misses++;
+		return NULL;
+	}
+
+	fs_readCacheLRU.splice( fs_readCacheLRU.begin(), fs_readCacheLRU, it->second );
+	fs_readCacheStats.hits++;
+	fs_readCacheStats.bytesSaved += it->second->data.size();
+	return &*it->second;
+}
+
+static void FS_AddReadCache( const fileInPack_t *file, const byte *data, int len ) {
+	size_t budget = (size_t)Q_max( fs_readCacheSize->integer, 0 ) << 10;
+
+	// one big file shouldn't flush everything else
+	if ( (size_t)len > budget / 4 ) {
+		return;
+	}
+
+	fs_readCacheLRU.emplace_front();
+	fs_readCacheLRU.front().file = file;
+	fs_readCacheLRU.front().data.assign( data, data + len );
+	fs_readCache[file] = fs_readCacheLRU.begin();
+	fs_readCacheBytes += len;
+
+	FS_TrimReadCache( budget );
+}
+
+static void FS_ReadCache_f( void ) {
+	int lookups = fs_readCacheStats.hits + fs_readCacheStats.misses;
+
+	Com_Printf( "%d files, %d KB cached of %d KB\n", (int)fs_readCache.size(),
+		(int)( fs_readCacheBytes >> 10 ), fs_readCacheSize->integer );
+	Com_Printf( "%d hits, %d misses (%.1f%%), %lld KB not inflated again\n", fs_readCacheStats.hits, fs_readCacheStats.misses,
+		lookups ? 100.0f * fs_readCacheStats.hits / lookups : 0.0f, (long long)( fs_readCacheStats.bytesSaved >> 10 ) );
+}
+
 /*
 ============
 FS_ReadFile
@@ -2099,7 +2871,17 @@ long FS_ReadFile( const char *qpath, void **buffer ) {
 
 //	Z_Label(buf, qpath);
 
-	FS_Read (buf, len, h);
+	if ( fsh[h].pakFile ) {
+		const readCacheEntry_t *cached = FS_FindReadCache( fsh[h].pakFile );
+
+		if ( cached ) {
+			Com_Memcpy( buf, cached->data.data(), len );
+		} else if ( FS_Read( buf, len, h ) == len ) {
+			FS_AddReadCache( fsh[h].pakFile, buf, len );
+		}
+	} else {
+		FS_Read (buf, len, h);
+	}
 
 	// guarantee that it will have a trailing 0 for string operations
 	buf[len] = 0;
@@ -2166,57 +2948,157 @@ ZIP FILE LOADING
 
 /*
 =================
-FS_LoadZipFile
+Pak directories
+
+The central directory of every pk3 is read into a pakDirectory_t first, which
+is plain data so it can be filled in by worker threads, and pack_t is built
+from it on the main thread. Directories are kept in fs_pakDirectories keyed by
+the pk3 path and saved to PAKCACHE_FILENAME in fs_homepath, so a pk3 with the
+same size and modification time is never walked again, across restarts and
+across runs.
+=================
+*/
+
+#define PAKCACHE_FILENAME		"pakcache.dat"
+#define PAKCACHE_VERSION		1
+#define FS_MAX_PAK_THREADS		8
+
+typedef struct {
+	uint32_t		name;		// offset into pakDirectory_t::names
+	uint32_t		pos;		// file info position in zip
+	uint32_t		len;		// uncompress file size
+	uint32_t		crc;
+} pakDirEntry_t;
+
+typedef struct {
+	int64_t						size;
+	int64_t						mtime;
+	int							numEntries;	// as reported by the zip, entries may stop short on errors
+	std::vector<pakDirEntry_t>	entries;
+	std::string					names;		// lowercased, null terminated
+} pakDirectory_t;
+
+static cvar_t		*fs_pakCache;
+static cvar_t		*fs_pakThreads;
+
+static std::unordered_map<std::string, pakDirectory_t>	fs_pakDirectories;
+static bool			fs_pakCacheLoaded;
+static bool			fs_pakCacheDirty;
+static int			fs_paksScanned;		// since the last FS_Startup
+static int			fs_paksCached;
+static int			fs_pakIndexMsec;
+
+static bool FS_StatPak( const char *zipfile, int64_t *size, int64_t *mtime ) {
+	struct stat buf;
+
+	if ( stat( zipfile, &buf ) == -1 ) {
+		return false;
+	}
+	*size = (int64_t)buf.st_size;
+	*mtime = (int64_t)buf.st_mtime;
+	return true;
+}
+
+/*
+=================
+FS_ReadPakDirectory
+
+Walks the central directory of a zip file. Doesn't touch the zone, so workers may
+call it on handles opened for them by the main thread
+=================
+*/
+static void FS_ReadPakDirectory( unzFile uf, const unz_global_info *gi, pakDirectory_t *dir ) {
+	char			filename_inzip[MAX_ZPATH];
+	unz_file_info	file_info;
+
+	dir->numEntries = gi->number_entry;
+	dir->entries.clear();
+	dir->entries.reserve( gi->number_entry );
+	dir->names.clear();
+
+	unzGoToFirstFile( uf );
+	for ( uLong i = 0; i < gi->number_entry; i++ ) {
+		pakDirEntry_t entry;
+
+		if ( unzGetCurrentFileInfo( uf, &file_info, filename_inzip, sizeof( filename_inzip ), NULL, 0, NULL, 0 ) != UNZ_OK ) {
+			break;
+		}
+		Q_strlwr( filename_inzip );
+
+		entry.name = (uint32_t)dir->names.size();
+		entry.pos = (uint32_t)unzGetOffset( uf );
+		entry.len = (uint32_t)file_info.uncompressed_size;
+		entry.crc = (uint32_t)file_info.crc;
+		dir->entries.push_back( entry );
+		dir->names.append( filename_inzip, strlen( filename_inzip ) + 1 );
+
+		unzGoToNextFile( uf );
+	}
+}
+
+/*
+=================
+FS_OpenPak
+
+Opens a zip file and checks whether cached still describes it, the directory
+is left for FS_ReadPakDirectory otherwise. Main thread only, minizip allocates
+from the zone.
+=================
+*/
+static unzFile FS_OpenPak( const char *zipfile, const pakDirectory_t *cached, const pakDirectory_t *dir, unz_global_info *gi, bool *fromCache ) {
+	unzFile			uf;
+
+	*fromCache = false;
+
+	uf = unzOpen( zipfile );
+	if ( !uf ) {
+		return NULL;
+	}
+	if ( unzGetGlobalInfo( uf, gi ) != UNZ_OK ) {
+		unzClose( uf );
+		return NULL;
+	}
+
+	if ( cached && cached->size == dir->size && cached->mtime == dir->mtime && cached->numEntries == (int)gi->number_entry ) {
+		*fromCache = true;
+	}
+
+	return uf;
+}
+
+/*
+=================
+FS_BuildPack
 
 Creates a new pak_t in the search chain for the contents
 of a zip file.
 =================
 */
-static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
+static pack_t *FS_BuildPack( const char *zipfile, const char *basename, unzFile uf, const pakDirectory_t *dir )
 {
 	fileInPack_t	*buildBuffer;
 	pack_t			*pack;
-	unzFile			uf;
-	int				err;
-	unz_global_info gi;
-	char			filename_inzip[MAX_ZPATH];
-	unz_file_info	file_info;
 	int				len;
 	size_t			i;
 	long			hash;
 	int				fs_numHeaderLongs;
 	int				*fs_headerLongs;
 	char			*namePtr;
+	int				numEntries = dir->numEntries;
 
 	fs_numHeaderLongs = 0;
 
-	uf = unzOpen(zipfile);
-	err = unzGetGlobalInfo (uf,&gi);
-
-	if (err != UNZ_OK)
-		return NULL;
-
-	len = 0;
-	unzGoToFirstFile(uf);
-	for (i = 0; i < gi.number_entry; i++)
-	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
-		}
-		len += strlen(filename_inzip) + 1;
-		unzGoToNextFile(uf);
-	}
+	len = (int)dir->names.size();
 
-	buildBuffer = (struct fileInPack_s *)Z_Malloc( (gi.number_entry * sizeof( fileInPack_t )) + len, TAG_FILESYS, qtrue );
-	namePtr = ((char *) buildBuffer) + gi.number_entry * sizeof( fileInPack_t );
-	fs_headerLongs = (int *)Z_Malloc( ( gi.number_entry + 1 ) * sizeof(int), TAG_FILESYS, qtrue );
+	buildBuffer = (struct fileInPack_s *)Z_Malloc( (numEntries * sizeof( fileInPack_t )) + len, TAG_FILESYS, qtrue );
+	namePtr = ((char *) buildBuffer) + numEntries * sizeof( fileInPack_t );
+	fs_headerLongs = (int *)Z_Malloc( ( numEntries + 1 ) * sizeof(int), TAG_FILESYS, qtrue );
 	fs_headerLongs[ fs_numHeaderLongs++ ] = LittleLong( fs_checksumFeed );
 
 	// get the hash table size from the number of files in the zip
 	// because lots of custom pk3 files have less than 32 or 64 files
 	for (i = 1; i <= MAX_FILEHASH_SIZE; i <<= 1) {
-		if (i > gi.number_entry) {
+		if (i > (size_t)numEntries) {
 			break;
 		}
 	}
@@ -2237,29 +3119,24 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 	}
 
 	pack->handle = uf;
-	pack->numfiles = gi.number_entry;
-	unzGoToFirstFile(uf);
+	pack->numfiles = numEntries;
 
-	for (i = 0; i < gi.number_entry; i++)
+	memcpy( namePtr, dir->names.data(), len );
+
+	for (i = 0; i < dir->entries.size(); i++)
 	{
-		err = unzGetCurrentFileInfo(uf, &file_info, filename_inzip, sizeof(filename_inzip), NULL, 0, NULL, 0);
-		if (err != UNZ_OK) {
-			break;
-		}
-		if (file_info.uncompressed_size > 0) {
-			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(file_info.crc);
+		const pakDirEntry_t *entry = &dir->entries[i];
+
+		if (entry->len > 0) {
+			fs_headerLongs[fs_numHeaderLongs++] = LittleLong(entry->crc);
 		}
-		Q_strlwr( filename_inzip );
-		hash = FS_HashFileName(filename_inzip, pack->hashSize);
-		buildBuffer[i].name = namePtr;
-		strcpy( buildBuffer[i].name, filename_inzip );
-		namePtr += strlen(filename_inzip) + 1;
+		buildBuffer[i].name = namePtr + entry->name;
+		hash = FS_HashFileName(buildBuffer[i].name, pack->hashSize);
 		// store the file position in the zip
-		buildBuffer[i].pos = unzGetOffset(uf);
-		buildBuffer[i].len = file_info.uncompressed_size;
+		buildBuffer[i].pos = entry->pos;
+		buildBuffer[i].len = entry->len;
 		buildBuffer[i].next = pack->hashTable[hash];
 		pack->hashTable[hash] = &buildBuffer[i];
-		unzGoToNextFile(uf);
 	}
 
 	pack->checksum = Com_BlockChecksum( &fs_headerLongs[ 1 ], sizeof(*fs_headerLongs) * ( fs_numHeaderLongs - 1 ) );
@@ -2273,6 +3150,276 @@ static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
 	return pack;
 }
 
+/*
+=================
+FS_LoadZipFile
+
+Creates a new pak_t for a single zip file, bypassing the directory cache
+=================
+*/
+static pack_t *FS_LoadZipFile( const char *zipfile, const char *basename )
+{
+	pakDirectory_t	dir;
+	unz_global_info	gi;
+	unzFile			uf;
+	bool			fromCache;
+
+	uf = FS_OpenPak( zipfile, NULL, &dir, &gi, &fromCache );
+	if ( !uf ) {
+		return NULL;
+	}
+	FS_ReadPakDirectory( uf, &gi, &dir );
+
+	return FS_BuildPack( zipfile, basename, uf, &dir );
+}
+
+/*
+=================
+FS_LoadPakCache
+
+Reads the saved pak directories, a damaged or outdated file is ignored
+=================
+*/
+static void FS_LoadPakCache( void ) {
+	char	path[MAX_OSPATH];
+	FILE	*f;
+	int		header[3];
+	bool	ok = true;
+
+	fs_pakCacheLoaded = true;
+	if ( !fs_pakCache->integer || !fs_homepath->string[0] ) {
+		return;
+	}
+
+	Com_sprintf( path, sizeof( path ), "%s%c%s", fs_homepath->string, PATH_SEP, PAKCACHE_FILENAME );
+	f = fopen( path, "rb" );
+	if ( !f ) {
+		return;
+	}
+
+	if ( fread( header, sizeof( header ), 1, f ) != 1 || header[0] != PAKCACHE_VERSION || header[1] != (int)sizeof( pakDirEntry_t ) ) {
+		fclose( f );
+		return;
+	}
+
+	for ( int i = 0; i < header[2] && ok; i++ ) {
+		char			pakPath[MAX_OSPATH];
+		int				counts[3];		// path length, entries, names length
+		pakDirectory_t	dir;
+
+		ok = fread( counts, sizeof( counts ), 1, f ) == 1
+			&& counts[0] > 0 && counts[0] < (int)sizeof( pakPath )
+			&& counts[1] >= 0 && counts[2] >= 0
+			&& fread( pakPath, counts[0], 1, f ) == 1
+			&& fread( &dir.size, sizeof( dir.size ), 1, f ) == 1
+			&& fread( &dir.mtime, sizeof( dir.mtime ), 1, f ) == 1
+			&& fread( &dir.numEntries, sizeof( dir.numEntries ), 1, f ) == 1
+			&& counts[1] <= dir.numEntries;
+		if ( !ok ) {
+			break;
+		}
+		pakPath[counts[0]] = 0;
+
+		dir.entries.resize( counts[1] );
+		dir.names.resize( counts[2] );
+		if ( counts[1] && fread( &dir.entries[0], sizeof( pakDirEntry_t ), counts[1], f ) != (size_t)counts[1] ) {
+			ok = false;
+			break;
+		}
+		if ( counts[2] && fread( &dir.names[0], counts[2], 1, f ) != 1 ) {
+			ok = false;
+			break;
+		}
+
+		// every name has to be in bounds and terminated
+		if ( counts[2] && dir.names[counts[2] - 1] ) {
+			ok = false;
+			break;
+		}
+		for ( const pakDirEntry_t &entry : dir.entries ) {
+			if ( entry.name >= (uint32_t)counts[2] ) {
+				ok = false;
+				break;
+			}
+		}
+
+		fs_pakDirectories[pakPath] = std::move( dir );
+	}
+
+	fclose( f );
+
+	if ( !ok ) {
+		Com_Printf( "Ignoring damaged %s\n", path );
+		fs_pakDirectories.clear();
+	}
+}
+
+/*
+=================
+FS_SavePakCache
+
+Writes the pak directories back if any pk3 had to be scanned, dropping the
+ones whose pk3 is gone or changed
+=================
+*/
+static void FS_SavePakCache( void ) {
+	char	path[MAX_OSPATH], tmpPath[MAX_OSPATH];
+	FILE	*f;
+	int		header[3];
+	bool	ok = true;
+
+	if ( !fs_pakCacheDirty || !fs_pakCache->integer || !fs_homepath->string[0] ) {
+		return;
+	}
+	fs_pakCacheDirty = false;
+
+	for ( auto it = fs_pakDirectories.begin(); it != fs_pakDirectories.end(); ) {
+		int64_t size, mtime;
+
+		if ( !FS_StatPak( it->first.c_str(), &size, &mtime ) || size != it->second.size || mtime != it->second.mtime ) {
+			it = fs_pakDirectories.erase( it );
+		} else {
+			++it;
+		}
+	}
+
+	Com_sprintf( path, sizeof( path ), "%s%c%s", fs_homepath->string, PATH_SEP, PAKCACHE_FILENAME );
+	Com_sprintf( tmpPath, sizeof( tmpPath ), "%s.tmp", path );
+	f = fopen( tmpPath, "wb" );
+	if ( !f ) {
+		Com_DPrintf( "Couldn't write %s\n", tmpPath );
+		return;
+	}
+
+	header[0] = PAKCACHE_VERSION;
+	header[1] = sizeof( pakDirEntry_t );
+	header[2] = (int)fs_pakDirectories.size();
+	ok = fwrite( header, sizeof( header ), 1, f ) == 1;
+
+	for ( auto &p : fs_pakDirectories ) {
+		const pakDirectory_t &dir = p.second;
+		int counts[3] = { (int)p.first.size(), (int)dir.entries.size(), (int)dir.names.size() };
+
+		if ( !ok ) {
+			break;
+		}
+		ok = fwrite( counts, sizeof( counts ), 1, f ) == 1
+			&& fwrite( p.first.c_str(), counts[0], 1, f ) == 1
+			&& fwrite( &dir.size, sizeof( dir.size ), 1, f ) == 1
+			&& fwrite( &dir.mtime, sizeof( dir.mtime ), 1, f ) == 1
+			&& fwrite( &dir.numEntries, sizeof( dir.numEntries ), 1, f ) == 1
+			&& ( !counts[1] || fwrite( dir.entries.data(), sizeof( pakDirEntry_t ), counts[1], f ) == (size_t)counts[1] )
+			&& ( !counts[2] || fwrite( dir.names.data(), counts[2], 1, f ) == 1 );
+	}
+
+	if ( fclose( f ) || !ok ) {
+		Com_DPrintf( "Couldn't write %s\n", tmpPath );
+		remove( tmpPath );
+		return;
+	}
+
+	remove( path );
+	if ( rename( tmpPath, path ) ) {
+		Com_DPrintf( "Couldn't rename %s to %s\n", tmpPath, path );
+		remove( tmpPath );
+	}
+}
+
+typedef struct {
+	char			path[MAX_OSPATH];
+	const char		*basename;
+	const pakDirectory_t	*cached;
+	pakDirectory_t	dir;
+	unz_global_info	gi;
+	unzFile			handle;
+	bool			fromCache;
+} pakJob_t;
+
+/*
+=================
+FS_LoadZipFiles
+
+Loads a batch of zip files, walking the directories that aren't cached on up
+to fs_pakThreads threads. The zips are opened and closed on the main thread,
+the workers only read through handles they own, which doesn't allocate.
+packs[i] is NULL if zipfiles[i] couldn't be loaded.
+=================
+*/
+static void FS_LoadZipFiles( const char *gamepath, char **basenames, int count, pack_t **packs ) {
+	std::vector<pakJob_t>	jobs( count );
+	std::atomic<int>		next( 0 );
+	int						numThreads;
+	int						start = Sys_Milliseconds();
+
+	if ( !fs_pakCacheLoaded ) {
+		FS_LoadPakCache();
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		Com_sprintf( jobs[i].path, sizeof( jobs[i].path ), "%s%c%s", gamepath, PATH_SEP, basenames[i] );
+		jobs[i].basename = basenames[i];
+
+		auto it = fs_pakDirectories.find( jobs[i].path );
+		jobs[i].cached = ( it != fs_pakDirectories.end() && fs_pakCache->integer ) ? &it->second : NULL;
+
+		jobs[i].handle = NULL;
+		if ( FS_StatPak( jobs[i].path, &jobs[i].dir.size, &jobs[i].dir.mtime ) ) {
+			jobs[i].handle = FS_OpenPak( jobs[i].path, jobs[i].cached, &jobs[i].dir, &jobs[i].gi, &jobs[i].fromCache );
+		}
+	}
+
+	numThreads = fs_pakThreads->integer;
+	if ( numThreads <= 0 ) {
+		numThreads = (int)std::thread::hardware_concurrency();
+	}
+	numThreads = Q_max( 1, Q_min( numThreads, Q_min( FS_MAX_PAK_THREADS, count ) ) );
+
+	auto worker = [&]() {
+		for ( int i = next++; i < count; i = next++ ) {
+			if ( jobs[i].handle && !jobs[i].fromCache ) {
+				FS_ReadPakDirectory( jobs[i].handle, &jobs[i].gi, &jobs[i].dir );
+			}
+		}
+	};
+
+	if ( numThreads > 1 ) {
+		std::vector<std::thread> threads;
+
+		for ( int i = 1; i < numThreads; i++ ) {
+			threads.emplace_back( worker );
+		}
+		worker();
+		for ( std::thread &t : threads ) {
+			t.join();
+		}
+	} else {
+		worker();
+	}
+
+	for ( int i = 0; i < count; i++ ) {
+		pakJob_t *job = &jobs[i];
+
+		packs[i] = NULL;
+		if ( !job->handle ) {
+			continue;
+		}
+
+		if ( job->fromCache ) {
+			fs_paksCached++;
+			packs[i] = FS_BuildPack( job->path, job->basename, job->handle, job->cached );
+		} else {
+			fs_paksScanned++;
+			packs[i] = FS_BuildPack( job->path, job->basename, job->handle, &job->dir );
+			if ( fs_pakCache->integer ) {
+				fs_pakDirectories[job->path] = std::move( job->dir );
+				fs_pakCacheDirty = true;
+			}
+		}
+	}
+
+	fs_pakIndexMsec += Sys_Milliseconds() - start;
+}
+
 /*
 =================
 FS_FreePak
@@ -3084,10 +4231,11 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 	searchpath_t	*search;
 	searchpath_t	*thedir;
 	pack_t			*pak;
-	char			curpath[MAX_OSPATH + 1], *pakfile;
+	char			curpath[MAX_OSPATH + 1];
 	int				numfiles;
 	char			**pakfiles;
 	char			*sorted[MAX_PAKFILES];
+	pack_t			*packs[MAX_PAKFILES];
 
 	// this fixes the case where fs_basepath is the same as fs_cdpath
 	// which happens on full installs
@@ -3130,9 +4278,10 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	qsort( sorted, numfiles, sizeof(char*), paksort );
 
+	FS_LoadZipFiles( curpath, sorted, numfiles, packs );
+
 	for ( i = 0 ; i < numfiles ; i++ ) {
-		pakfile = FS_BuildOSPath( path, dir, sorted[i] );
-		if ( ( pak = FS_LoadZipFile( pakfile, sorted[i] ) ) == 0 )
+		if ( ( pak = packs[i] ) == 0 )
 			continue;
 		Q_strncpyz(pak->pakPathname, curpath, sizeof(pak->pakPathname));
 		// store the game name for downloading
@@ -3164,6 +4313,9 @@ static void FS_AddGameDirectory( const char *path, const char *dir ) {
 
 	// done
 	Sys_FreeFileList( pakfiles );
+
+	// the file index and directory misses don't know the new paths yet
+	FS_ClearFileIndex();
 }
 
 /*
@@ -3357,7 +4509,12 @@ void FS_Shutdown( qboolean closemfp ) {
 		}
 	}
 
+	// make sure everything written asynchronously reaches the disk
+	FS_StopAsyncWriters();
+
 	// free everything
+	FS_ClearFileIndex();
+	FS_ClearReadCache();
 	for ( p = fs_searchpaths ; p ; p = next ) {
 		next = p->next;
 
@@ -3378,6 +4535,8 @@ void FS_Shutdown( qboolean closemfp ) {
 	Cmd_RemoveCommand( "fdir" );
 	Cmd_RemoveCommand( "touchFile" );
 	Cmd_RemoveCommand( "which" );
+	Cmd_RemoveCommand( "fs_writers" );
+	Cmd_RemoveCommand( "fs_readcache" );
 
 #ifdef FS_MISSING
 	if (closemfp) {
@@ -3445,6 +4604,9 @@ static void FS_ReorderPurePaks()
 			p_previous = &s->next;
 		}
 	}
+
+	// rebuilt in the new order on the next lookup
+	FS_ClearFileIndex();
 }
 
 /**
@@ -3471,8 +4633,14 @@ void FS_Startup( const char *gameName ) {
 	Com_Printf( "----- FS_Startup -----\n" );
 
 	fs_packFiles = 0;
+	fs_paksScanned = fs_paksCached = fs_pakIndexMsec = 0;
 
 	fs_debug = Cvar_Get( "fs_debug", "0", 0 );
+	fs_pakCache = Cvar_Get( "fs_pakCache", "1", CVAR_ARCHIVE_ND, "Keep the directories of unchanged pk3 files in " PAKCACHE_FILENAME " instead of reading them on every start" );
+	fs_pakThreads = Cvar_Get( "fs_pakThreads", "0", CVAR_ARCHIVE_ND, "Number of threads reading pk3 directories, 0 uses one per core" );
+	fs_asyncWriters = Cvar_Get( "fs_asyncWriters", "2", CVAR_ARCHIVE_ND, "Number of threads writing demos and other async files" );
+	fs_asyncBufferSize = Cvar_Get( "fs_asyncBufferSize", "256", CVAR_ARCHIVE_ND, "Buffer size in KB for each async file" );
+	fs_readCacheSize = Cvar_Get( "fs_readCacheSize", "8192", CVAR_ARCHIVE_ND, "KB of files from pk3s kept in memory so they don't have to be inflated again" );
 	fs_copyfiles = Cvar_Get( "fs_copyfiles", "0", CVAR_INIT );
 	fs_cdpath = Cvar_Get ("fs_cdpath", "", CVAR_INIT|CVAR_PROTECTED, "(Read Only) Location for development files" );
 	fs_basepath = Cvar_Get ("fs_basepath", Sys_DefaultInstallPath(), CVAR_INIT|CVAR_PROTECTED, "(Read Only) Location for game files" );
@@ -3541,6 +4709,8 @@ void FS_Startup( const char *gameName ) {
 	Cmd_AddCommand ("fdir", FS_NewDir_f, "Lists a folder with filters" );
 	Cmd_AddCommand ("touchFile", FS_TouchFile_f, "Touches a file" );
 	Cmd_AddCommand ("which", FS_Which_f, "Determines which search path a file was loaded from" );
+	Cmd_AddCommand ("fs_writers", FS_Writers_f, "Prints async file writer statistics" );
+	Cmd_AddCommand ("fs_readcache", FS_ReadCache_f, "Prints file read cache statistics" );
 
 	// https://zerowing.idsoftware.com/bugzilla/show_bug.cgi?id=506
 	// reorder the pure pk3 files according to server order
@@ -3559,6 +4729,10 @@ void FS_Startup( const char *gameName ) {
 	}
 #endif
 	Com_Printf( "%d files in pk3 files\n", fs_packFiles );
+	Com_DPrintf( "%d pk3 files indexed, %d from the pak cache, in %d msec\n",
+		fs_paksScanned + fs_paksCached, fs_paksCached, fs_pakIndexMsec );
+
+	FS_SavePakCache();
 }
 
 /*
@@ -4079,6 +5253,10 @@ int		FS_FTell( fileHandle_t f ) {
 }
 
 void	FS_Flush( fileHandle_t f ) {
+	if ( fsh[f].handleAsync ) {
+		FS_FlushAsync( f );
+		return;
+	}
 	fflush(fsh[f].handleFiles.file.o);
 }
 
@@ -0,0 +1,182 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+// q_iptrie.c -- path compressed binary trie of IPv4 prefixes
+
+#include "q_iptrie.h"
+
+#include <stdlib.h>
+
+static uint32_t IPTrie_Mask( int length ) {
+	return length > 0 ? 0xFFFFFFFFu << ( 32 - length ) : 0u;
+}
+
+static int IPTrie_Bit( uint32_t address, int index ) {
+	return (int)( ( address >> ( 31 - index ) ) & 1u );
+}
+
+// length of the prefix two addresses have in common, at most max bits
+static int IPTrie_CommonLength( uint32_t a, uint32_t b, int max ) {
+	uint32_t diff = a ^ b;
+	int length = 0;
+
+	while ( length < max && !( diff & 0x80000000u ) ) {
+		diff <<= 1;
+		length++;
+	}
+
+	return length;
+}
+
+static int IPTrie_NewNode( ipTrie_t *trie, uint32_t prefix, int length, int flags ) {
+	ipTrieNode_t *node;
+
+	if ( trie->numNodes == trie->maxNodes ) {
+		int maxNodes = trie->maxNodes ? trie->maxNodes * 2 : 64;
+		ipTrieNode_t *nodes = (ipTrieNode_t *)realloc( trie->nodes, maxNodes * sizeof( ipTrieNode_t ) );
+
+		if ( !nodes ) {
+			return -1;
+		}
+		trie->nodes = nodes;
+		trie->maxNodes = maxNodes;
+	}
+
+	node = &trie->nodes[trie->numNodes];
+	node->prefix = prefix;
+	node->length = length;
+	node->flags = flags;
+	node->child[0] = node->child[1] = -1;
+
+	return trie->numNodes++;
+}
+
+void IPTrie_Init( ipTrie_t *trie ) {
+	trie->nodes = NULL;
+	trie->numNodes = trie->maxNodes = 0;
+	trie->root = -1;
+	trie->numPrefixes = 0;
+}
+
+void IPTrie_Clear( ipTrie_t *trie ) {
+	free( trie->nodes );
+	IPTrie_Init( trie );
+}
+
+/*
+=================
+IPTrie_Insert
+
+Adds flags to the prefix address/length, splitting the compressed path where
+the new prefix leaves it. Returns qfalse if out of memory.
+=================
+*/
+qboolean IPTrie_Insert( ipTrie_t *trie, uint32_t address, int length, int flags ) {
+	int parent = -1, side = 0, index, common, branch, leaf;
+
+	if ( length < 0 )
+		length = 0;
+	else if ( length > 32 )
+		length = 32;
+	address &= IPTrie_Mask( length );
+
+	for ( index = trie->root; index >= 0; index = trie->nodes[index].child[side] ) {
+		ipTrieNode_t *node = &trie->nodes[index];
+
+		common = IPTrie_CommonLength( node->prefix, address, Q_min( node->length, length ) );
+		if ( common < node->length ) {
+			break;
+		}
+
+		if ( node->length == length ) {
+			if ( !node->flags ) {
+				trie->numPrefixes++;
+			}
+			node->flags |= flags;
+			return qtrue;
+		}
+
+		parent = index;
+		side = IPTrie_Bit( address, node->length );
+	}
+
+	if ( index < 0 ) {
+		// fell off the end of the path
+		leaf = IPTrie_NewNode( trie, address, length, flags );
+		if ( leaf < 0 ) {
+			return qfalse;
+		}
+	} else if ( common == length ) {
+		// the new prefix sits above the node it diverged at
+		leaf = IPTrie_NewNode( trie, address, length, flags );
+		if ( leaf < 0 ) {
+			return qfalse;
+		}
+		trie->nodes[leaf].child[IPTrie_Bit( trie->nodes[index].prefix, length )] = index;
+	} else {
+		// both continue past the point they differ, branch there
+		branch = IPTrie_NewNode( trie, address & IPTrie_Mask( common ), common, 0 );
+		leaf = branch >= 0 ? IPTrie_NewNode( trie, address, length, flags ) : -1;
+		if ( leaf < 0 ) {
+			return qfalse;
+		}
+		trie->nodes[branch].child[IPTrie_Bit( address, common )] = leaf;
+		trie->nodes[branch].child[IPTrie_Bit( trie->nodes[index].prefix, common )] = index;
+		leaf = branch;
+	}
+
+	if ( parent < 0 ) {
+		trie->root = leaf;
+	} else {
+		trie->nodes[parent].child[side] = leaf;
+	}
+	trie->numPrefixes++;
+
+	return qtrue;
+}
+
+/*
+=================
+IPTrie_Match
+
+Returns the flags of all prefixes that contain address, one step per stored
+prefix length at most
+=================
+*/
+int IPTrie_Match( const ipTrie_t *trie, uint32_t address ) {
+	int flags = 0, index;
+
+	for ( index = trie->root; index >= 0; ) {
+		const ipTrieNode_t *node = &trie->nodes[index];
+
+		if ( ( address & IPTrie_Mask( node->length ) ) != node->prefix ) {
+			break;
+		}
+
+		flags |= node->flags;
+
+		if ( node->length == 32 ) {
+			break;
+		}
+		index = node->child[IPTrie_Bit( address, node->length )];
+	}
+
+	return flags;
+}
@@ -0,0 +1,47 @@
+/*
+===========================================================================
+Copyright (C) 2013 - 2015, OpenJK contributors
+
+This file is part of the OpenJK source code.
+
+OpenJK is free software; you can redistribute it and/or modify it
+under the terms of the GNU General Public License version 2 as
+published by the Free Software Foundation.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program; if not, see <http://www.gnu.org/licenses/>.
+===========================================================================
+*/
+
+#pragma once
+
+// q_iptrie.h -- path compressed binary trie of IPv4 prefixes, shared by the
+// server ban list and the game's ip filters
+
+#include "q_shared.h"
+
+typedef struct ipTrieNode_s {
+	uint32_t	prefix;			// address bits, the ones past length are zero
+	int			length;			// prefix length in bits
+	int			flags;			// caller flags of the prefix ending here, 0 for a pure branch
+	int			child[2];		// node indices, -1 for none
+} ipTrieNode_t;
+
+typedef struct ipTrie_s {
+	ipTrieNode_t	*nodes;
+	int				numNodes;
+	int				maxNodes;
+	int				root;			// -1 while empty
+	int				numPrefixes;
+} ipTrie_t;
+
+// addresses are in host order, the first octet in the high bits
+void		IPTrie_Init( ipTrie_t *trie );
+void		IPTrie_Clear( ipTrie_t *trie );		// frees the nodes, the trie stays usable
+qboolean	IPTrie_Insert( ipTrie_t *trie, uint32_t address, int length, int flags );
+int			IPTrie_Match( const ipTrie_t *trie, uint32_t address );	// flags of every prefix containing address
@@ -750,8 +750,7 @@ typedef struct cvar_s {
 	float			min, max;
 
 	struct cvar_s	*next, *prev;
-	struct cvar_s	*hashNext, *hashPrev;
-	int				hashIndex;
+	int				hashIndex;			// slot in the cvar hash table
 } cvar_t;
 
 #define	MAX_CVAR_VALUE_STRING	256
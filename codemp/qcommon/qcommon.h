@@ -478,6 +478,9 @@ void	Cvar_Register( vmCvar_t *vmCvar, const char *varName, const char *defaultVa
 void	Cvar_Update( vmCvar_t *vmCvar );
 // updates an interpreted modules' version of a cvar
 
+int		Cvar_ModificationCount( void );
+// changes whenever any cvar is created, changed or removed
+
 cvar_t	*Cvar_Set2(const char *var_name, const char *value, uint32_t defaultFlags, qboolean force);
 //
 
@@ -610,10 +613,16 @@ int		FS_GetFileList(  const char *path, const char *extension, char *listbuf, in
 int		FS_GetModList(  char *listbuf, int bufsize );
 
 fileHandle_t	FS_FOpenFileWriteAsync( const char *qpath, qboolean safe=qtrue );
+fileHandle_t	FS_FOpenFileWriteCompressed( const char *qpath, qboolean safe=qtrue );
+// gzipped on the writer thread, with a seek index next to it
+void	FS_AsyncMark( fileHandle_t f, int key );
+// makes a seek point at the current end of a compressed file
 fileHandle_t	FS_FOpenFileWrite( const char *qpath, qboolean safe=qtrue );
 // will properly create any needed paths and deal with seperater character issues
 
 int		FS_filelength( fileHandle_t f );
+int64_t	FS_FileModificationTime( fileHandle_t f );
+// -1 if unknown
 fileHandle_t FS_SV_FOpenFileWrite( const char *filename );
 int		FS_SV_FOpenFileRead( const char *filename, fileHandle_t *fp );
 void	FS_SV_Rename( const char *from, const char *to, qboolean safe );
@@ -776,6 +785,7 @@ void		Com_StartupVariable( const char *match );
 
 // alpha - enhanced logging system
 void		Com_Log( const char* str );
+void		Com_FlushLog( void );
 
 
 extern	cvar_t	*com_developer;
@@ -907,6 +917,10 @@ void Hunk_Trash( void );
 
 void Com_TouchMemory( void );
 
+// scratch memory released at the end of the server frame, main thread only
+void *Frame_Alloc( int size );
+void Frame_Reset( void );
+
 // commandLine should not include the executable name (argv[0])
 void Com_Init( char *commandLine );
 void Com_Frame( void );
@@ -83,6 +83,10 @@ typedef struct zoneStats_s
 	int		iSizesPerTag [TAG_COUNT];
 	int		iCountsPerTag[TAG_COUNT];
 
+	// running totals for the allocation rates in zone_stats
+	//
+	unsigned int	uiAllocsPerTag[TAG_COUNT];
+
 } zoneStats_t;
 
 typedef struct zone_s
@@ -96,6 +100,223 @@ cvar_t	*com_validateZone;
 zone_t	TheZone = {};
 
 
+// Small blocks (header and tail included) come from per-size-class pools instead of malloc.
+// Each class carves 64k pages into blocks of its size and keeps the freed ones on a list,
+// so the churn of short strings and small structs never reaches the system heap. Pages are
+// kept until the zone is shut down.
+//
+#define ZONE_POOL_PAGE_SIZE		(64*1024)
+#define ZONE_POOL_GRANULARITY	16
+#define ZONE_POOL_MAX_BLOCK		1024
+
+static const int ziPoolBlockSizes[] = { 48, 64, 80, 96, 128, 160, 192, 256, 320, 384, 512, 640, 768, 1024 };
+#define ZONE_POOL_CLASSES	ARRAY_LEN( ziPoolBlockSizes )
+
+typedef struct zonePoolBlock_s
+{
+	struct zonePoolBlock_s	*pNext;
+} zonePoolBlock_t;
+
+typedef struct zonePoolPage_s
+{
+	struct zonePoolPage_s	*pNext;
+	int						iPad[2];		// keeps the blocks 16 byte aligned
+} zonePoolPage_t;
+
+typedef struct
+{
+	zonePoolBlock_t	*pFree;
+	int				iBlocks;		// carved from pages
+	int				iFree;
+	int				iPages;
+} zonePool_t;
+
+static zonePool_t		zonePools[ZONE_POOL_CLASSES];
+static zonePoolPage_t	*zonePoolPages;
+static byte				zonePoolForSize[ZONE_POOL_MAX_BLOCK / ZONE_POOL_GRANULARITY + 1];
+
+static inline int Zone_PoolForSize(int iRealSize)
+{
+	if (iRealSize > ZONE_POOL_MAX_BLOCK)
+	{
+		return -1;
+	}
+
+	if (!zonePoolForSize[0])
+	{
+		// lazily build the size -> class lookup, 0 can't be a valid entry since nothing is that small
+		//
+		int iPool = 0;
+		for (int i = 0; i <= ZONE_POOL_MAX_BLOCK / ZONE_POOL_GRANULARITY; i++)
+		{
+			while (ziPoolBlockSizes[iPool] < i * ZONE_POOL_GRANULARITY)
+			{
+				iPool++;
+			}
+			zonePoolForSize[i] = iPool + 1;
+		}
+	}
+
+	return zonePoolForSize[(iRealSize + ZONE_POOL_GRANULARITY - 1) / ZONE_POOL_GRANULARITY] - 1;
+}
+
+static zoneHeader_t *Zone_PoolAlloc(int iPool)
+{
+	zonePool_t *pPool = &zonePools[iPool];
+
+	if (!pPool->pFree)
+	{
+		zonePoolPage_t *pPage = (zonePoolPage_t *) malloc(ZONE_POOL_PAGE_SIZE);
+		if (!pPage)
+		{
+			return NULL;
+		}
+		pPage->pNext = zonePoolPages;
+		zonePoolPages = pPage;
+		pPool->iPages++;
+
+		int iBlockSize = ziPoolBlockSizes[iPool];
+		byte *pBlock = (byte *) &pPage[1];
+		byte *pEnd = (byte *) pPage + ZONE_POOL_PAGE_SIZE;
+		for ( ; pBlock + iBlockSize <= pEnd; pBlock += iBlockSize)
+		{
+			zonePoolBlock_t *pFreeBlock = (zonePoolBlock_t *) pBlock;
+			pFreeBlock->pNext = pPool->pFree;
+			pPool->pFree = pFreeBlock;
+			pPool->iBlocks++;
+			pPool->iFree++;
+		}
+	}
+
+	zonePoolBlock_t *pBlock = pPool->pFree;
+	pPool->pFree = pBlock->pNext;
+	pPool->iFree--;
+	return (zoneHeader_t *) pBlock;
+}
+
+static void Zone_PoolFree(int iPool, zoneHeader_t *pMemory)
+{
+	zonePool_t *pPool = &zonePools[iPool];
+	zonePoolBlock_t *pBlock = (zonePoolBlock_t *) pMemory;
+
+	pBlock->pNext = pPool->pFree;
+	pPool->pFree = pBlock;
+	pPool->iFree++;
+}
+
+static void Zone_PoolShutdown(void)
+{
+	while (zonePoolPages)
+	{
+		zonePoolPage_t *pNext = zonePoolPages->pNext;
+		free(zonePoolPages);
+		zonePoolPages = pNext;
+	}
+	memset(zonePools, 0, sizeof(zonePools));
+}
+
+
+// Frame arena, linear scratch memory for allocations that only have to live until the end of
+// the current server frame. Frame_Reset releases all of it at once at the end of SV_Frame.
+// Whatever doesn't fit goes to the heap for that frame, and the arena is regrown to the
+// frame's high-water mark on the next reset. Main thread only, like the rest of the zone.
+//
+#define FRAME_ARENA_ALIGN		16
+#define FRAME_ARENA_GRANULARITY	(16*1024)
+
+typedef struct frameOverflow_s
+{
+	struct frameOverflow_s	*pNext;
+} frameOverflow_t;
+
+#define FRAME_OVERFLOW_HEADER	((sizeof(frameOverflow_t) + FRAME_ARENA_ALIGN - 1) & ~(FRAME_ARENA_ALIGN - 1))
+
+static byte				*frameArena;
+static int				frameArenaSize;
+static int				frameArenaUsed;
+static int				frameArenaDemand;	// bytes asked for this frame, overflow included
+static int				frameArenaPeak;
+static unsigned int		frameArenaAllocs;
+static unsigned int		frameArenaOverflows;
+static frameOverflow_t	*frameOverflows;
+
+cvar_t	*com_frameArenaSize;
+cvar_t	*com_frameArenaPeak;
+
+void *Frame_Alloc(int iSize)
+{
+	iSize = (Q_max(iSize, 1) + FRAME_ARENA_ALIGN - 1) & ~(FRAME_ARENA_ALIGN - 1);
+
+	frameArenaDemand += iSize;
+	frameArenaAllocs++;
+
+	if (frameArenaUsed + iSize <= frameArenaSize)
+	{
+		void *pvMem = frameArena + frameArenaUsed;
+		frameArenaUsed += iSize;
+		return pvMem;
+	}
+
+	frameOverflow_t *pOverflow = (frameOverflow_t *) malloc(FRAME_OVERFLOW_HEADER + iSize);
+	if (!pOverflow)
+	{
+		Com_Error(ERR_FATAL, "Frame_Alloc(): failed on allocation of %i bytes", iSize);
+		return NULL;
+	}
+	pOverflow->pNext = frameOverflows;
+	frameOverflows = pOverflow;
+	frameArenaOverflows++;
+
+	return (byte *) pOverflow + FRAME_OVERFLOW_HEADER;
+}
+
+static void Frame_FreeOverflows(void)
+{
+	while (frameOverflows)
+	{
+		frameOverflow_t *pNext = frameOverflows->pNext;
+		free(frameOverflows);
+		frameOverflows = pNext;
+	}
+}
+
+void Frame_Reset(void)
+{
+	Frame_FreeOverflows();
+
+	if (frameArenaDemand > frameArenaPeak)
+	{
+		frameArenaPeak = frameArenaDemand;
+		if (com_frameArenaPeak)
+		{
+			Cvar_Set("com_frameArenaPeak", va("%d", frameArenaPeak));
+		}
+	}
+
+	int iWanted = com_frameArenaSize ? com_frameArenaSize->integer * 1024 : 0;
+	iWanted = Q_max(iWanted, frameArenaPeak);
+	iWanted = (iWanted + FRAME_ARENA_GRANULARITY - 1) & ~(FRAME_ARENA_GRANULARITY - 1);
+
+	if (iWanted != frameArenaSize)
+	{
+		free(frameArena);
+		frameArena = (byte *) malloc(iWanted);
+		frameArenaSize = frameArena ? iWanted : 0;
+	}
+
+	frameArenaUsed = 0;
+	frameArenaDemand = 0;
+}
+
+static void Frame_Shutdown(void)
+{
+	Frame_FreeOverflows();
+	free(frameArena);
+	frameArena = NULL;
+	frameArenaSize = frameArenaUsed = frameArenaDemand = 0;
+}
+
+
 // Scans through the linked list of mallocs and makes sure no data has been overwritten
 
 void Z_Validate(void)
@@ -195,7 +416,13 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 			Sys_Sleep(1000);	// sleep for a second, so Windows has a chance to shuffle mem to de-swiss-cheese it
 		}
 
-		if (bZeroit) {
+		int iPool = Zone_PoolForSize(iRealSize);
+		if (iPool >= 0) {
+			pMemory = Zone_PoolAlloc(iPool);
+			if (pMemory && bZeroit) {
+				memset(pMemory, 0, iRealSize);
+			}
+		} else if (bZeroit) {
 			pMemory = (zoneHeader_t *) calloc ( iRealSize, 1 );
 		} else {
 			pMemory = (zoneHeader_t *) malloc ( iRealSize );
@@ -304,6 +531,7 @@ void *Z_Malloc(int iSize, memtag_t eTag, qboolean bZeroit /* = qfalse */, int iU
 	TheZone.Stats.iCount++;
 	TheZone.Stats.iSizesPerTag	[eTag] += iSize;
 	TheZone.Stats.iCountsPerTag	[eTag]++;
+	TheZone.Stats.uiAllocsPerTag[eTag]++;
 
 	if (TheZone.Stats.iCurrent > TheZone.Stats.iPeak)
 	{
@@ -391,7 +619,16 @@ static void Zone_FreeBlock(zoneHeader_t *pMemory)
 		{
 			pMemory->pNext->pPrev = pMemory->pPrev;
 		}
-		free (pMemory);
+
+		int iPool = Zone_PoolForSize(pMemory->iSize + sizeof(zoneHeader_t) + sizeof(zoneTail_t));
+		if (iPool >= 0)
+		{
+			Zone_PoolFree(iPool, pMemory);
+		}
+		else
+		{
+			free (pMemory);
+		}
 
 
 		#ifdef DETAILED_ZONE_DEBUG_CODE
@@ -548,6 +785,44 @@ static void Z_Stats_f(void)
 									TheZone.Stats.iPeak,
 									         (float)TheZone.Stats.iPeak / 1024.0f / 1024.0f
 				);
+
+	int iPoolPages = 0, iPoolBlocks = 0, iPoolFree = 0;
+	for (size_t i = 0; i < ZONE_POOL_CLASSES; i++)
+	{
+		iPoolPages	+= zonePools[i].iPages;
+		iPoolBlocks	+= zonePools[i].iBlocks;
+		iPoolFree	+= zonePools[i].iFree;
+	}
+	Com_Printf("Small block pools: %d blocks in use, %d free, in %d pages (%.2fMB)\n",
+									iPoolBlocks - iPoolFree, iPoolFree, iPoolPages,
+									(float)iPoolPages * ZONE_POOL_PAGE_SIZE / 1024.0f / 1024.0f
+				);
+	Com_Printf("Frame arena: %dk, peaked at %d bytes, %u allocations (%u went to the heap)\n",
+									frameArenaSize / 1024, frameArenaPeak,
+									frameArenaAllocs, frameArenaOverflows
+				);
+
+	// allocation rates since the last time this was asked for
+	//
+	static unsigned int	uiLastAllocs[TAG_COUNT];
+	static int			iLastTime;
+	int iTime = Sys_Milliseconds();
+	float fSeconds = (float)(iTime - iLastTime) / 1000.0f;
+
+	if (iLastTime && fSeconds > 0.0f)
+	{
+		Com_Printf("Allocations per second over the last %.1f seconds:\n", fSeconds);
+		for (int i=0; i<TAG_COUNT; i++)
+		{
+			unsigned int uiAllocs = TheZone.Stats.uiAllocsPerTag[i] - uiLastAllocs[i];
+			if (uiAllocs)
+			{
+				Com_Printf("%20s %9.1f\n", psTagStrings[i], (float)uiAllocs / fSeconds);
+			}
+		}
+	}
+	memcpy(uiLastAllocs, TheZone.Stats.uiAllocsPerTag, sizeof(uiLastAllocs));
+	iLastTime = iTime;
 }
 
 // Gives a detailed breakdown of the memory blocks in the zone
@@ -599,6 +874,9 @@ void Com_ShutdownZoneMemory(void)
 		assert(!TheZone.Stats.iCount);
 		assert(!TheZone.Stats.iCurrent);
 	}
+
+	Zone_PoolShutdown();
+	Frame_Shutdown();
 }
 
 // Initialises the zone memory system
@@ -616,6 +894,9 @@ void Com_InitZoneMemoryVars( void ) {
 	com_validateZone = Cvar_Get("com_validateZone", "0", 0);
 //#endif
 
+	com_frameArenaSize = Cvar_Get("com_frameArenaSize", "256", CVAR_ARCHIVE_ND, "Size in KB of the per-frame scratch arena, it grows on its own if a frame needs more");
+	com_frameArenaPeak = Cvar_Get("com_frameArenaPeak", "0", CVAR_ROM, "Most scratch memory in bytes a single frame has needed");
+
 	Cmd_AddCommand("zone_stats", Z_Stats_f, "Prints out zone memory stats" );
 	Cmd_AddCommand("zone_details", Z_Details_f, "Prints out full detailed zone memory info" );
 
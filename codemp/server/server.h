@@ -25,6 +25,7 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 
 #include "qcommon/q_shared.h"
 #include "qcommon/qcommon.h"
+#include "qcommon/q_iptrie.h"
 #include "game/g_public.h"
 #include "game/bg_public.h"
 #include "rd-common/tr_public.h"
@@ -54,6 +55,8 @@ typedef enum {
 	SS_GAME				// actively running
 } serverState_t;
 
+#define CONFIGSTRING_HASH_SIZE	2048	// power of two
+
 typedef struct server_s {
 	serverState_t	state;
 	qboolean		restarting;			// if true, send configstring changes during SS_LOADING
@@ -64,6 +67,12 @@ typedef struct server_s {
 	int				timeResidual;		// <= 1000 / sv_frame->value
 	int				nextFrameTime;		// when time > nextFrameTime, process world
 	char			*configstrings[MAX_CONFIGSTRINGS];
+	int				configstringHash[CONFIGSTRING_HASH_SIZE];	// first index + 1 of each chain, by value
+	int				configstringNext[MAX_CONFIGSTRINGS];		// next index + 1 in the chain
+	uint32_t		configstringUsed[(MAX_CONFIGSTRINGS + 31) / 32];	// bit for each non-empty configstring
+	int				changedConfigstrings[MAX_CONFIGSTRINGS];	// changed this frame, sent by SV_FlushConfigstrings
+	int				numChangedConfigstrings;
+	qboolean		configstringChanged[MAX_CONFIGSTRINGS];
 	svEntity_t		svEntities[MAX_GENTITIES];
 
 	char			*entityParsePoint;	// used during game VM init
@@ -127,10 +136,13 @@ typedef struct {
 	qboolean	demowaiting;	// don't record until a non-delta message is sent
 	int			minDeltaFrame;	// the first non-delta frame stored in the demo.  cannot delta against frames older than this
 	fileHandle_t	demofile;
+	int			seekBytes;		// written since the last seek point of a compressed demo
 	qboolean	isBot;
 	int			botReliableAcknowledge; // for bots, need to maintain a separate reliableAcknowledge to record server messages into the demo file
 } demoInfo_t;
 
+typedef struct downloadFile_s downloadFile_t;
+typedef struct downloadChunk_s downloadChunk_t;
 
 typedef struct client_s {
 	clientState_t	state;
@@ -156,13 +168,14 @@ typedef struct client_s {
 
 	// downloading
 	char			downloadName[MAX_QPATH]; // if not empty string, we are downloading
-	fileHandle_t	download;			// file being downloaded
+	downloadFile_t	*download;			// file being downloaded, shared with other clients
  	int				downloadSize;		// total bytes (can't use EOF because of paks)
  	int				downloadCount;		// bytes sent
 	int				downloadClientBlock;	// last block we sent to the client, awaiting ack
 	int				downloadCurrentBlock;	// current block number
 	int				downloadXmitBlock;	// last block we xmited
-	unsigned char	*downloadBlocks[MAX_DOWNLOAD_WINDOW];	// the buffers for the download blocks
+	downloadChunk_t	*downloadChunks[MAX_DOWNLOAD_WINDOW];	// cache chunks referenced by the window
+	const byte		*downloadBlocks[MAX_DOWNLOAD_WINDOW];	// the download blocks, pointing into downloadChunks
 	int				downloadBlockSize[MAX_DOWNLOAD_WINDOW];
 	qboolean		downloadEOF;		// We have sent the EOF block
 	int				downloadSendTime;	// time we last got an ack from the client
@@ -188,6 +201,7 @@ typedef struct client_s {
 
 	int				oldServerTime;
 	qboolean		csUpdated[MAX_CONFIGSTRINGS];
+	qboolean		csPending;		// csUpdated has changes of this frame to send while active
 
 	demoInfo_t		demo;
 } client_t;
@@ -195,6 +209,23 @@ typedef struct client_s {
 //=============================================================================
 
 
+// pre-built getstatus/getinfo reply, the challenge is spliced in per request
+typedef struct svResponseCache_s {
+	qboolean	valid;
+	int			serverInfoModCount;			// svs.serverInfoModCount it was built for
+	int			clients, humans;			// player counts it was built for (getinfo)
+	int			infoLength;					// the infostring at the start of body
+	int			bodyLength;
+	char		body[MAX_MSGLEN];
+} svResponseCache_t;
+
+typedef struct svStatusPlayer_s {
+	qboolean	connected;
+	int			score;
+	int			ping;
+	char		name[MAX_NAME_LENGTH];
+} svStatusPlayer_t;
+
 // this structure will be cleared only when the game dll changes
 typedef struct serverStatic_s {
 	qboolean	initialized;				// sv_init has completed
@@ -214,9 +245,16 @@ typedef struct serverStatic_s {
 	netadr_t	authorizeAddress;			// for rcon return messages
 
 	qboolean	gameStarted;				// gvm is loaded
+
+	int			serverInfoModCount;			// bumped whenever CS_SERVERINFO changes
+	svResponseCache_t	statusCache;
+	svResponseCache_t	infoCache;
+	svStatusPlayer_t	statusPlayers[MAX_CLIENTS];	// what statusCache was built from
+
+	int			configstringSends;			// configstring updates sent to active clients
+	int			configstringSendsCoalesced;	// updates replaced by a later one in the same frame
 } serverStatic_t;
 
-#define SERVER_MAXBANS	1024
 // Structure for managing bans
 typedef struct serverBan_s {
 	netadr_t ip;
@@ -272,39 +310,51 @@ extern	cvar_t	*sv_filterCommands;
 extern	cvar_t	*sv_autoDemo;
 extern	cvar_t	*sv_autoDemoBots;
 extern	cvar_t	*sv_autoDemoMaxMaps;
+extern	cvar_t	*sv_autoDemoMultiView;
+extern	cvar_t	*sv_demoCompress;
+extern	cvar_t	*sv_rateLimitBuckets;
+extern	cvar_t	*sv_rateLimitSubnet;
+extern	cvar_t	*sv_downloadCacheSize;
 extern	cvar_t	*sv_legacyFixes;
 extern	cvar_t	*sv_banFile;
 // alpha - base_enhanced start
 extern	cvar_t	*sv_printFullConnect;
+extern	cvar_t	*sv_dbWAL;
+extern	cvar_t	*sv_dbSynchronous;
+extern	cvar_t	*sv_dbBatchWindow;
+extern	cvar_t	*sv_dbPersistData;
+
+#define BANTRIE_BAN			1
+#define BANTRIE_EXCEPTION	2
 
-extern	serverBan_t serverBans[SERVER_MAXBANS];
+extern	serverBan_t *serverBans;
 extern	int serverBansCount;
+extern	ipTrie_t serverBanTrie;			// serverBans indexed by address prefix
 
 //===========================================================
 
 //
 // sv_main.c
 //
-typedef struct leakyBucket_s leakyBucket_t;
-struct leakyBucket_s {
-	netadrtype_t	type;
-
-	union {
-		byte	_4[4];
-	} ipv;
-
+typedef struct leakyBucket_s {
 	int					lastTime;
 	signed char			burst;
+} leakyBucket_t;
 
-	long				hash;
-
-	leakyBucket_t *prev, *next;
-};
+// connectionless requests counted by the address rate limiter
+typedef enum {
+	RATELIMIT_STATUS,
+	RATELIMIT_INFO,
+	RATELIMIT_CONNECT,
+	RATELIMIT_RCON,
+	RATELIMIT_MAX
+} rateLimitCategory_t;
 
 extern leakyBucket_t outboundLeakyBucket;
 
 qboolean SVC_RateLimit( leakyBucket_t *bucket, int burst, int period );
-qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period );
+qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period, rateLimitCategory_t category );
+void SV_RateLimitInfo_f( void );
 void SV_FinalMessage (char *message);
 void QDECL SV_SendServerCommand( client_t *cl, const char *fmt, ...);
 
@@ -324,7 +374,11 @@ void SV_MasterShutdown (void);
 //
 void SV_SetConfigstring( int index, const char *val );
 void SV_GetConfigstring( int index, char *buffer, int bufferSize );
+int SV_FindConfigstringIndex( const char *name, int start, int max, qboolean create );
 void SV_UpdateConfigstrings( client_t *client );
+void SV_SendChangedConfigstrings( client_t *client );
+void SV_FlushConfigstrings( void );
+void SV_ConfigstringInfo_f( void );
 
 void SV_SetUserinfo( int index, const char *val );
 void SV_GetUserinfo( int index, char *buffer, int bufferSize );
@@ -361,6 +415,16 @@ void SV_ClientThink (client_t *cl, usercmd_t *cmd);
 
 void SV_WriteDownloadToClient( client_t *cl , msg_t *msg );
 
+//
+// sv_download.cpp
+//
+downloadFile_t *SV_OpenDownloadFile( const char *name, int *size );
+void SV_CloseDownloadFile( downloadFile_t *file );
+int SV_ReadDownloadBlock( downloadFile_t *file, int offset, downloadChunk_t **chunk, const byte **data );
+void SV_ReleaseDownloadChunk( downloadChunk_t *chunk );
+void SV_ShutdownDownloads( void );
+void SV_DownloadInfo_f( void );
+
 //
 // sv_ccmds.c
 //
@@ -370,6 +434,18 @@ void SV_StopRecordDemo( client_t *cl );
 void SV_AutoRecordDemo( client_t *cl );
 void SV_StopAutoRecordDemos();
 void SV_BeginAutoRecordDemos();
+const char *SV_DemoExtension( const char *ext );
+void SV_StopDemoTasks( void );
+
+//
+// sv_mvdemo.cpp
+//
+void SV_StartMultiViewDemo( const char *demoName );
+void SV_StopMultiViewDemo( void );
+qboolean SV_MultiViewDemoRecording( void );
+void SV_MultiViewDemoFrame( void );
+void SV_MultiViewDemoCommand( client_t *cl, const char *cmd );
+void SV_MultiViewDemoConfigstring( int index );
 
 //
 // sv_snapshot.c
@@ -483,6 +559,13 @@ dbStmt_t* SV_CreateDBStatement( const char* sql );
 void SV_FreeDBStatement( dbStmt_t* stmt );
 void SV_SetDBData( const char* name, void* data, size_t size );
 const void* SV_GetDBData( const char* name, size_t* outSize, qboolean remove );
+dbStmt_t* SV_CreateDBAsyncStatement( const char* sql );
+qboolean SV_ExecDBStatementAsync( dbStmt_t* stmt, DBResultCallback callback, DBCompleteCallback complete, void* userData );
+qboolean SV_ExecDBQueryAsync( const char* sql, DBResultCallback callback, DBCompleteCallback complete, void* userData );
+void SV_FlushDBBatch( qboolean force );
+void SV_RunDBCallbacks();
+void SV_FinishDBRequests( qboolean runCallbacks );
+void SV_DBInfo_f( void );
 
 //
 // sv_crypto.cpp
@@ -27,6 +27,8 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "qcommon/cm_public.h"
 #include "server/sv_gameapi.h"
 
+#include <algorithm>
+
 typedef struct bot_debugpoly_s
 {
 	int inuse;
@@ -89,6 +91,70 @@ void SV_BotWaypointReception(int wpnum, wpobject_t **wps)
 	}
 }
 
+// spatial hash over waypoint xy so linking only looks at nearby candidates
+#define WP_GRID_BUCKETS		1024
+
+static int wpGridHead[WP_GRID_BUCKETS];
+static int wpGridNext[MAX_WPARRAY_SIZE];
+static int wpGridCandidates[MAX_WPARRAY_SIZE];
+
+static int SV_WPGridBucket( int cx, int cy )
+{
+	return (int)((((unsigned)cx * 73856093u) ^ ((unsigned)cy * 19349663u)) & (WP_GRID_BUCKETS-1));
+}
+
+static void SV_WPBuildGrid( float cellSize )
+{
+	for ( int i = 0; i < WP_GRID_BUCKETS; i++ )
+	{
+		wpGridHead[i] = -1;
+	}
+
+	for ( int i = 0; i < gWPNum; i++ )
+	{
+		if ( gWPArray[i] && gWPArray[i]->inuse )
+		{
+			int b = SV_WPGridBucket( (int)floor( gWPArray[i]->origin[0] / cellSize ), (int)floor( gWPArray[i]->origin[1] / cellSize ) );
+
+			wpGridNext[i] = wpGridHead[b];
+			wpGridHead[b] = i;
+		}
+	}
+}
+
+// every waypoint whose xy distance to org could be within one cell, in ascending index order
+static int SV_WPGridCandidates( const vec3_t org, float cellSize, int *out )
+{
+	int visited[9];
+	int numVisited = 0;
+	int num = 0;
+	int cx = (int)floor( org[0] / cellSize );
+	int cy = (int)floor( org[1] / cellSize );
+
+	for ( int x = cx-1; x <= cx+1; x++ )
+	{
+		for ( int y = cy-1; y <= cy+1; y++ )
+		{
+			int b = SV_WPGridBucket( x, y );
+
+			if ( std::find( visited, visited + numVisited, b ) != visited + numVisited )
+			{ // hash collision with a cell we already walked
+				continue;
+			}
+			visited[numVisited++] = b;
+
+			for ( int c = wpGridHead[b]; c != -1; c = wpGridNext[c] )
+			{
+				out[num++] = c;
+			}
+		}
+	}
+
+	std::sort( out, out + num );
+
+	return num;
+}
+
 /*
 ==================
 SV_BotCalculatePaths
@@ -98,6 +164,8 @@ void SV_BotCalculatePaths( int /*rmg*/ )
 {
 	int i;
 	int c;
+	int n;
+	int numCandidates;
 	int forceJumpable;
 	int maxNeighborDist = MAX_NEIGHBOR_LINK_DISTANCE;
 	float nLDist;
@@ -123,28 +191,28 @@ void SV_BotCalculatePaths( int /*rmg*/ )
 	{
 		if (gWPArray[i] && gWPArray[i]->inuse && gWPArray[i]->neighbornum)
 		{
-			while (gWPArray[i]->neighbornum >= 0)
-			{
-				gWPArray[i]->neighbors[gWPArray[i]->neighbornum].num = 0;
-				gWPArray[i]->neighbors[gWPArray[i]->neighbornum].forceJumpTo = 0;
-				gWPArray[i]->neighbornum--;
-			}
+			memset( gWPArray[i]->neighbors, 0, sizeof( gWPArray[i]->neighbors ) );
 			gWPArray[i]->neighbornum = 0;
 		}
 
 		i++;
 	}
 
+	// pairs further apart than maxNeighborDist never link, so only neighbouring cells need checking
+	SV_WPBuildGrid( (float)maxNeighborDist );
+
 	i = 0;
 
 	while (i < gWPNum)
 	{
 		if (gWPArray[i] && gWPArray[i]->inuse)
 		{
-			c = 0;
+			numCandidates = SV_WPGridCandidates( gWPArray[i]->origin, (float)maxNeighborDist, wpGridCandidates );
 
-			while (c < gWPNum)
+			for ( n = 0; n < numCandidates; n++ )
 			{
+				c = wpGridCandidates[n];
+
 				if (gWPArray[c] && gWPArray[c]->inuse && i != c &&
 					NotWithinRange(i, c))
 				{
@@ -174,7 +242,6 @@ void SV_BotCalculatePaths( int /*rmg*/ )
 						break;
 					}
 				}
-				c++;
 			}
 		}
 		i++;
@@ -726,6 +793,7 @@ void SV_BotInitBotLib(void) {
 	botlib_import.FS_Write = FS_Write;
 	botlib_import.FS_FCloseFile = FS_FCloseFile;
 	botlib_import.FS_Seek = FS_Seek;
+	botlib_import.FS_FOpenFileWriteAsync = FS_FOpenFileWriteAsync;
 
 	//debug lines
 	botlib_import.DebugLineCreate = BotImport_DebugLineCreate;
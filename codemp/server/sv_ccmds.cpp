@@ -27,6 +27,22 @@ along with this program; if not, see <http://www.gnu.org/licenses/>.
 #include "server/sv_gameapi.h"
 #include "qcommon/game_version.h"
 
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include <direct.h>
+#define rmdir _rmdir
+#else
+#include <unistd.h>
+#endif
+
 /*
 ===============================================================================
 
@@ -574,23 +590,43 @@ static void SV_KickNum_f( void ) {
 
 /*
 ==================
-SV_RehashBans_f
+SV_ReserveBans
+
+Grow the ban list to hold at least count entries.
+==================
+*/
+static void SV_ReserveBans( int count )
+{
+	static int maxBans;
+
+	if ( count <= maxBans )
+		return;
+
+	maxBans = Q_max( count, maxBans * 2 );
+	maxBans = Q_max( maxBans, 64 );
+
+	serverBan_t *bans = (serverBan_t *)Z_Malloc( maxBans * sizeof( serverBan_t ), TAG_GENERAL, qtrue );
+	if ( serverBansCount )
+		memcpy( bans, serverBans, serverBansCount * sizeof( serverBan_t ) );
+	if ( serverBans )
+		Z_Free( serverBans );
+	serverBans = bans;
+}
+
+/*
+==================
+SV_LoadBans
 
 Load saved bans from file.
 ==================
 */
-static void SV_RehashBans_f( void )
+static void SV_LoadBans( void )
 {
 	int index, filelen;
 	fileHandle_t readfrom;
 	char *textbuf, *curpos, *maskpos, *newlinepos, *endpos;
 	char filepath[MAX_QPATH];
 
-	// make sure server is running
-	if ( !com_sv_running->integer ) {
-		return;
-	}
-
 	serverBansCount = 0;
 
 	if ( !sv_banFile->string || !*sv_banFile->string )
@@ -614,7 +650,7 @@ static void SV_RehashBans_f( void )
 
 		endpos = textbuf + filelen;
 
-		for ( index = 0; index < SERVER_MAXBANS && curpos + 2 < endpos; index++ )
+		for ( index = 0; curpos + 2 < endpos; )
 		{
 			// find the end of the address string
 			for ( maskpos = curpos + 2; maskpos < endpos && *maskpos != ' '; maskpos++ );
@@ -633,6 +669,8 @@ static void SV_RehashBans_f( void )
 
 			*newlinepos = '\0';
 
+			SV_ReserveBans( index + 1 );
+
 			if ( NET_StringToAdr( curpos + 2, &serverBans[index].ip ) )
 			{
 				serverBans[index].isexception = (qboolean)(curpos[0] != '0');
@@ -643,6 +681,8 @@ static void SV_RehashBans_f( void )
 				{
 					serverBans[index].subnet = 32;
 				}
+
+				index++;
 			}
 
 			curpos = newlinepos + 1;
@@ -654,6 +694,45 @@ static void SV_RehashBans_f( void )
 	}
 }
 
+/*
+==================
+SV_RebuildBanTrie
+
+Index the ban list by address prefix for SV_IsBanned.
+==================
+*/
+static void SV_RebuildBanTrie( void )
+{
+	int index;
+
+	IPTrie_Clear( &serverBanTrie );
+
+	for ( index = 0; index < serverBansCount; index++ )
+	{
+		if ( serverBans[index].ip.type == NA_IP )
+		{
+			IPTrie_Insert( &serverBanTrie, NET_AdrToInt( serverBans[index].ip ), serverBans[index].subnet,
+				serverBans[index].isexception ? BANTRIE_EXCEPTION : BANTRIE_BAN );
+		}
+	}
+}
+
+/*
+==================
+SV_RehashBans_f
+==================
+*/
+static void SV_RehashBans_f( void )
+{
+	// make sure server is running
+	if ( !com_sv_running->integer ) {
+		return;
+	}
+
+	SV_LoadBans();
+	SV_RebuildBanTrie();
+}
+
 /*
 ==================
 SV_WriteBans
@@ -698,18 +777,9 @@ Remove a ban or an exception from the list.
 ==================
 */
 
-static qboolean SV_DelBanEntryFromList( int index ) {
-	if ( index == serverBansCount - 1 )
-		serverBansCount--;
-	else if ( index < (int)ARRAY_LEN( serverBans ) - 1 )
-	{
-		memmove( serverBans + index, serverBans + index + 1, (serverBansCount - index - 1) * sizeof( *serverBans ) );
-		serverBansCount--;
-	}
-	else
-		return qtrue;
-
-	return qfalse;
+static void SV_DelBanEntryFromList( int index ) {
+	memmove( serverBans + index, serverBans + index + 1, (serverBansCount - index - 1) * sizeof( *serverBans ) );
+	serverBansCount--;
 }
 
 /*
@@ -784,12 +854,6 @@ static void SV_AddBanToList( qboolean isexception )
 		return;
 	}
 
-	if ( serverBansCount >= (int)ARRAY_LEN( serverBans ) )
-	{
-		Com_Printf( "Error: Maximum number of bans/exceptions exceeded.\n" );
-		return;
-	}
-
 	banstring = Cmd_Argv( 1 );
 
 	if ( strchr( banstring, '.' ) /*|| strchr( banstring, ':' )*/ )
@@ -883,12 +947,15 @@ static void SV_AddBanToList( qboolean isexception )
 			index++;
 	}
 
+	SV_ReserveBans( serverBansCount + 1 );
+
 	serverBans[serverBansCount].ip = ip;
 	serverBans[serverBansCount].subnet = mask;
 	serverBans[serverBansCount].isexception = isexception;
 
 	serverBansCount++;
 
+	SV_RebuildBanTrie();
 	SV_WriteBans();
 
 	Com_Printf( "Added %s: %s/%d\n", isexception ? "ban exception" : "ban",
@@ -983,6 +1050,7 @@ static void SV_DelBanFromList( qboolean isexception )
 		}
 	}
 
+	SV_RebuildBanTrie();
 	SV_WriteBans();
 }
 
@@ -1049,6 +1117,7 @@ static void SV_FlushBans_f( void )
 	}
 
 	serverBansCount = 0;
+	SV_RebuildBanTrie();
 
 	// empty the ban file.
 	SV_WriteBans();
@@ -1524,9 +1593,18 @@ static void SV_KillServer_f( void ) {
 	SV_Shutdown( "killserver" );
 }
 
+// compressed demos get a seek point about this often
+#define DEMO_SEEK_SPACING	( 64 * 1024 )
+
 void SV_WriteDemoMessage ( client_t *cl, msg_t *msg, int headerBytes ) {
 	int		len, swlen;
 
+	if ( cl->demo.seekBytes >= DEMO_SEEK_SPACING ) {
+		FS_AsyncMark( cl->demo.demofile, sv.time );
+		cl->demo.seekBytes = 0;
+	}
+	cl->demo.seekBytes += 8 + msg->cursize - headerBytes;
+
 	// write the packet sequence
 	len = cl->netchan.outgoingSequence;
 	swlen = LittleLong( len );
@@ -1559,6 +1637,7 @@ void SV_StopRecordDemo( client_t *cl ) {
 
 // stops all recording demos
 void SV_StopAutoRecordDemos() {
+	SV_StopMultiViewDemo();
 	if ( svs.clients && sv_autoDemo->integer ) {
 		for ( client_t *client = svs.clients; client - svs.clients < sv_maxclients->integer; client++ ) {
 			if ( client->demo.demorecording) {
@@ -1601,6 +1680,17 @@ void SV_StopRecord_f( void ) {
 	SV_StopRecordDemo( cl );
 }
 
+/*
+==================
+SV_DemoExtension
+
+File extension of a new demo, compressed demos get .gz on top
+==================
+*/
+const char *SV_DemoExtension( const char *ext ) {
+	return va( ".%s_%d%s", ext, PROTOCOL_VERSION, sv_demoCompress->integer ? ".gz" : "" );
+}
+
 /*
 ==================
 SV_DemoFilename
@@ -1637,14 +1727,19 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 
 	// open the demo file
 	Q_strncpyz( cl->demo.demoName, demoName, sizeof( cl->demo.demoName ) );
-	Com_sprintf( name, sizeof( name ), "demos/%s.dm_%d", cl->demo.demoName, PROTOCOL_VERSION );
+	Com_sprintf( name, sizeof( name ), "demos/%s%s", cl->demo.demoName, SV_DemoExtension( "dm" ) );
 	Com_Printf( "recording to %s.\n", name );
-	cl->demo.demofile = FS_FOpenFileWriteAsync( name );
+	if ( sv_demoCompress->integer ) {
+		cl->demo.demofile = FS_FOpenFileWriteCompressed( name );
+	} else {
+		cl->demo.demofile = FS_FOpenFileWriteAsync( name );
+	}
 	if ( !cl->demo.demofile ) {
 		Com_Printf ("ERROR: couldn't open.\n");
 		return;
 	}
 	cl->demo.demorecording = qtrue;
+	cl->demo.seekBytes = 0;
 
 	// don't start saving messages until a non-delta compressed message is received
 	cl->demo.demowaiting = qtrue;
@@ -1674,6 +1769,8 @@ void SV_RecordDemo( client_t *cl, char *demoName ) {
 	// the rest of the demo file will be copied from net messages
 }
 
+static void SV_AddAutoDemoToManifest( const char *demoPath );
+
 void SV_AutoRecordDemo( client_t *cl ) {
 	char demoName[MAX_OSPATH];
 	char demoFolderName[MAX_OSPATH];
@@ -1702,6 +1799,39 @@ void SV_AutoRecordDemo( client_t *cl ) {
 	}
 	Com_sprintf( demoName, sizeof( demoName ), "autorecord/%s/%s/%s", folderTreeDate, demoFolderName, demoFileName );
 	SV_RecordDemo( cl, demoName );
+	if ( cl->demo.demorecording ) {
+		SV_AddAutoDemoToManifest( va( "%s%s", demoName, SV_DemoExtension( "dm" ) ) );
+	}
+}
+
+// same folder as the client demos of the map so sv_autoDemoMaxMaps prunes it with them
+static void SV_AutoRecordMultiViewDemo( void ) {
+	char demoName[MAX_OSPATH];
+	char demoFolderName[MAX_OSPATH];
+	char demoFileName[MAX_OSPATH];
+	char *demoNames[] = { demoFolderName, demoFileName };
+	char date[MAX_OSPATH];
+	char folderDate[MAX_OSPATH];
+	char folderTreeDate[MAX_OSPATH];
+	time_t rawtime;
+	struct tm * timeinfo;
+	time( &rawtime );
+	timeinfo = localtime( &rawtime );
+	strftime( date, sizeof( date ), "%Y-%m-%d_%H-%M-%S", timeinfo );
+	timeinfo = localtime( &sv.realMapTimeStarted );
+	strftime( folderDate, sizeof( folderDate ), "%Y-%m-%d_%H-%M-%S", timeinfo );
+	strftime( folderTreeDate, sizeof( folderTreeDate ), "%Y/%m/%d", timeinfo );
+	Com_sprintf( demoFileName, sizeof( demoFileName ), "multiview %s %s", Cvar_VariableString( "mapname" ), date );
+	Com_sprintf( demoFolderName, sizeof( demoFolderName ), "%s %s", Cvar_VariableString( "mapname" ), folderDate );
+	// sanitize filename
+	for ( char **start = demoNames; start - demoNames < (ptrdiff_t)ARRAY_LEN( demoNames ); start++ ) {
+		Q_strstrip( *start, "\n\r;:.?*<>|\\/\"", NULL );
+	}
+	Com_sprintf( demoName, sizeof( demoName ), "autorecord/%s/%s/%s", folderTreeDate, demoFolderName, demoFileName );
+	SV_StartMultiViewDemo( demoName );
+	if ( SV_MultiViewDemoRecording() ) {
+		SV_AddAutoDemoToManifest( va( "%s%s", demoName, SV_DemoExtension( "mvd" ) ) );
+	}
 }
 
 static time_t SV_ExtractTimeFromDemoFolder( char *folder ) {
@@ -1780,47 +1910,235 @@ static int SV_FindLeafFolders( const char *baseFolder, char *result, int maxResu
 	return resultCount;
 }
 
+/*
+=============================================================================
+
+Autorecord demo maintenance
+
+Every autorecorded demo is listed in demos/autorecord/manifest.txt, oldest
+first, so pruning old maps doesn't have to walk the demo folders. Adding to
+the manifest and pruning run on a background thread that only uses plain
+file calls, the game thread just queues the tasks.
+
+=============================================================================
+*/
+
+#define DEMO_MANIFEST		"autorecord/manifest.txt"
+
+typedef enum {
+	DEMOTASK_ADD,		// append a demo to the manifest
+	DEMOTASK_PRUNE		// delete all but the newest map folders
+} demoTaskType_t;
+
+typedef struct {
+	demoTaskType_t	type;
+	std::string		demosPath;		// os path of the demos folder
+	std::string		demo;			// relative to demosPath
+	int				keepMaps;
+} demoTask_t;
+
+static std::thread				*demoTaskThread;
+static std::mutex				demoTaskLock;
+static std::condition_variable	demoTaskReady;
+static std::deque<demoTask_t>	demoTasks;
+static bool						demoTasksQuit;
+static qboolean					demoManifestChecked;
+
+static std::string SV_DemoFolderOf( const std::string &demo ) {
+	size_t slash = demo.rfind( '/' );
+	return slash == std::string::npos ? std::string() : demo.substr( 0, slash );
+}
+
+static void SV_DemoTaskAdd( const demoTask_t &task ) {
+	FILE *f = fopen( ( task.demosPath + "/" DEMO_MANIFEST ).c_str(), "a" );
+	if ( !f ) {
+		return;
+	}
+	fprintf( f, "%s\n", task.demo.c_str() );
+	fclose( f );
+}
+
+static void SV_DemoTaskPrune( const demoTask_t &task ) {
+	std::string manifestPath = task.demosPath + "/" DEMO_MANIFEST;
+	std::vector<std::string> demos, folders, kept;
+	char line[MAX_OSPATH];
+	FILE *f;
+
+	f = fopen( manifestPath.c_str(), "r" );
+	if ( !f ) {
+		return;
+	}
+	while ( fgets( line, sizeof( line ), f ) ) {
+		line[strcspn( line, "\r\n" )] = '\0';
+		// only ever touch what's in the autorecord folder
+		if ( Q_strncmp( line, "autorecord/", 11 ) || strstr( line, ".." ) ) {
+			continue;
+		}
+		demos.push_back( line );
+		std::string folder = SV_DemoFolderOf( demos.back() );
+		if ( std::find( folders.begin(), folders.end(), folder ) == folders.end() ) {
+			folders.push_back( folder );
+		}
+	}
+	fclose( f );
+
+	if ( (int)folders.size() <= task.keepMaps ) {
+		return;
+	}
+	folders.resize( folders.size() - task.keepMaps );
+
+	for ( const std::string &demo : demos ) {
+		if ( std::find( folders.begin(), folders.end(), SV_DemoFolderOf( demo ) ) == folders.end() ) {
+			kept.push_back( demo );
+			continue;
+		}
+		std::string path = task.demosPath + "/" + demo;
+		if ( remove( path.c_str() ) && errno != ENOENT ) {
+			// still open on some systems, try again next time
+			kept.push_back( demo );
+			continue;
+		}
+		remove( ( path + ".idx" ).c_str() );
+	}
+
+	// remove the folders and their parents as far as they're empty now
+	for ( const std::string &folder : folders ) {
+		std::string dir = folder;
+		while ( dir.length() > strlen( "autorecord" ) && !rmdir( ( task.demosPath + "/" + dir ).c_str() ) ) {
+			dir = SV_DemoFolderOf( dir );
+		}
+	}
+
+	std::string tmpPath = manifestPath + ".tmp";
+	f = fopen( tmpPath.c_str(), "w" );
+	if ( !f ) {
+		return;
+	}
+	for ( const std::string &demo : kept ) {
+		fprintf( f, "%s\n", demo.c_str() );
+	}
+	fclose( f );
+	remove( manifestPath.c_str() );
+	rename( tmpPath.c_str(), manifestPath.c_str() );
+}
+
+static void SV_DemoTaskThread( void ) {
+	while ( 1 ) {
+		demoTask_t task;
+		{
+			std::unique_lock<std::mutex> l( demoTaskLock );
+			demoTaskReady.wait( l, [] { return !demoTasks.empty() || demoTasksQuit; } );
+			if ( demoTasks.empty() ) {
+				return;
+			}
+			task = std::move( demoTasks.front() );
+			demoTasks.pop_front();
+		}
+
+		switch ( task.type ) {
+		case DEMOTASK_ADD:
+			SV_DemoTaskAdd( task );
+			break;
+		case DEMOTASK_PRUNE:
+			SV_DemoTaskPrune( task );
+			break;
+		}
+	}
+}
+
+static void SV_QueueDemoTask( demoTaskType_t type, const char *demo, int keepMaps ) {
+	demoTask_t task;
+
+	task.type = type;
+	task.demosPath = FS_BuildOSPath( Cvar_VariableString( "fs_homepath" ), FS_GetCurrentGameDir(), "demos" );
+	task.demo = demo;
+	task.keepMaps = keepMaps;
+
+	if ( !demoTaskThread ) {
+		demoTasksQuit = false;
+		demoTaskThread = new std::thread( SV_DemoTaskThread );
+	}
+	{
+		std::lock_guard<std::mutex> l( demoTaskLock );
+		demoTasks.push_back( std::move( task ) );
+	}
+	demoTaskReady.notify_one();
+}
+
+// finishes the queued tasks
+void SV_StopDemoTasks( void ) {
+	if ( !demoTaskThread ) {
+		return;
+	}
+	{
+		std::lock_guard<std::mutex> l( demoTaskLock );
+		demoTasksQuit = true;
+	}
+	demoTaskReady.notify_one();
+	demoTaskThread->join();
+	delete demoTaskThread;
+	demoTaskThread = NULL;
+	demoManifestChecked = qfalse;
+}
+
+// demos recorded before there was a manifest are listed once, oldest first
+static void SV_CheckDemoManifest( void ) {
+	if ( demoManifestChecked ) {
+		return;
+	}
+	demoManifestChecked = qtrue;
+
+	if ( FS_FileExists( "demos/" DEMO_MANIFEST ) ) {
+		return;
+	}
+
+	char *autorecordDirList = (char *)Z_Malloc( 500 * MAX_OSPATH, TAG_FILESYS );
+	char *fileList = (char *)Z_Malloc( 500 * MAX_OSPATH, TAG_FILESYS );
+	int autorecordDirListCount = SV_FindLeafFolders( "demos/autorecord", autorecordDirList, 500, MAX_OSPATH );
+
+	qsort( autorecordDirList, autorecordDirListCount, MAX_OSPATH, SV_DemoFolderTimeComparator );
+	for ( int i = autorecordDirListCount - 1; i >= 0; i-- ) {
+		char *folder = &autorecordDirList[i * MAX_OSPATH];
+		int numFiles = FS_GetFileList( folder, "", fileList, 500 * MAX_OSPATH );
+		char *fileName = fileList;
+
+		for ( int j = 0; j < numFiles; j++, fileName += strlen( fileName ) + 1 ) {
+			// the seek indexes go with their demos
+			if ( !Q_stricmp( COM_GetExtension( fileName ), "idx" ) ) {
+				continue;
+			}
+			SV_QueueDemoTask( DEMOTASK_ADD, va( "%s/%s", folder + strlen( "demos/" ), fileName ), 0 );
+		}
+	}
+
+	Z_Free( fileList );
+	Z_Free( autorecordDirList );
+}
+
+static void SV_AddAutoDemoToManifest( const char *demoPath ) {
+	SV_CheckDemoManifest();
+	SV_QueueDemoTask( DEMOTASK_ADD, demoPath, 0 );
+}
+
 // starts demo recording on all active clients
 void SV_BeginAutoRecordDemos() {
 	if ( sv_autoDemo->integer ) {
-		for ( client_t *client = svs.clients; client - svs.clients < sv_maxclients->integer; client++ ) {
-			if ( client->state == CS_ACTIVE && !client->demo.demorecording ) {
-				if ( client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer ) {
-					SV_AutoRecordDemo( client );
-				}
+		SV_CheckDemoManifest();
+		if ( sv_autoDemoMultiView->integer ) {
+			if ( !SV_MultiViewDemoRecording() ) {
+				SV_AutoRecordMultiViewDemo();
 			}
-		}
-		if ( sv_autoDemoMaxMaps->integer > 0 && sv.demosPruned == qfalse ) {
-			char autorecordDirList[500 * MAX_OSPATH], tmpFileList[5 * MAX_OSPATH];
-			int autorecordDirListCount = SV_FindLeafFolders( "demos/autorecord", autorecordDirList, 500, MAX_OSPATH );
-			int i;
-
-			qsort( autorecordDirList, autorecordDirListCount, MAX_OSPATH, SV_DemoFolderTimeComparator );
-			for ( i = sv_autoDemoMaxMaps->integer; i < autorecordDirListCount; i++ ) {
-				char *folder = &autorecordDirList[i * MAX_OSPATH], *slash = NULL;
-				FS_HomeRmdir( folder, qtrue );
-				// if this folder was the last thing in its parent folder (and its parent isn't the root folder),
-				// also delete the parent.
-				for (;;) {
-					slash = strrchr( folder, '/' );
-					if ( slash == NULL ) {
-						break;
-					}
-					slash[0] = '\0';
-					if ( !strcmp( folder, "demos/autorecord" ) ) {
-						break;
-					}
-					int numFiles = FS_GetFileList( folder, "", tmpFileList, sizeof( tmpFileList ) );
-					int numFolders = FS_GetFileList( folder, "/", tmpFileList, sizeof( tmpFileList ) );
-					// numFolders will include . and ..
-					if ( numFiles == 0 && numFolders == 2 ) {
-						// dangling empty folder, delete
-						FS_HomeRmdir( folder, qfalse );
-					} else {
-						break;
+		} else {
+			for ( client_t *client = svs.clients; client - svs.clients < sv_maxclients->integer; client++ ) {
+				if ( client->state == CS_ACTIVE && !client->demo.demorecording ) {
+					if ( client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer ) {
+						SV_AutoRecordDemo( client );
 					}
 				}
 			}
+		}
+		if ( sv_autoDemoMaxMaps->integer > 0 && sv.demosPruned == qfalse ) {
+			SV_QueueDemoTask( DEMOTASK_PRUNE, "", sv_autoDemoMaxMaps->integer );
 			sv.demosPruned = qtrue;
 		}
 	}
@@ -1890,12 +2208,12 @@ static void SV_Record_f( void ) {
 	if ( Cmd_Argc() >= 2 ) {
 		s = Cmd_Argv( 1 );
 		Q_strncpyz( demoName, s, sizeof( demoName ) );
-		Com_sprintf( name, sizeof( name ), "demos/%s.dm_%d", demoName, PROTOCOL_VERSION );
+		Com_sprintf( name, sizeof( name ), "demos/%s%s", demoName, SV_DemoExtension( "dm" ) );
 	} else {
 		// timestamp the file
 		SV_DemoFilename( demoName, sizeof( demoName ) );
 
-		Com_sprintf (name, sizeof(name), "demos/%s.dm_%d", demoName, PROTOCOL_VERSION );
+		Com_sprintf (name, sizeof(name), "demos/%s%s", demoName, SV_DemoExtension( "dm" ) );
 
 		if ( FS_FileExists( name ) ) {
 			Com_Printf( "Record: Couldn't create a file\n");
@@ -1966,6 +2284,10 @@ void SV_AddOperatorCommands( void ) {
 	Cmd_AddCommand ("sv_bandel", SV_BanDel_f, "Removes a ban" );
 	Cmd_AddCommand ("sv_exceptdel", SV_ExceptDel_f, "Removes a ban exception" );
 	Cmd_AddCommand ("sv_flushbans", SV_FlushBans_f, "Removes all bans and exceptions" );
+	Cmd_AddCommand ("sv_dbinfo", SV_DBInfo_f, "Prints server database and data store statistics" );
+	Cmd_AddCommand ("sv_ratelimitinfo", SV_RateLimitInfo_f, "Prints connectionless request rate limiter statistics" );
+	Cmd_AddCommand ("sv_downloadinfo", SV_DownloadInfo_f, "Prints shared download cache statistics" );
+	Cmd_AddCommand ("sv_configstringinfo", SV_ConfigstringInfo_f, "Prints how many configstring updates were sent and coalesced" );
 }
 
 /*
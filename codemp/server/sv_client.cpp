@@ -75,7 +75,7 @@ void SV_GetChallenge( netadr_t from ) {
 	}
 
 	// Prevent using getchallenge as an amplifier
-	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
+	if ( SVC_RateLimitAddress( from, 10, 1000, RATELIMIT_CONNECT ) ) {
 		if ( com_developer->integer ) {
 			Com_Printf( "SV_GetChallenge: rate limit from %s exceeded, dropping request\n",
 				NET_AdrToString( from ) );
@@ -96,38 +96,21 @@ void SV_GetChallenge( netadr_t from ) {
 ==================
 SV_IsBanned
 
-Check whether a certain address is banned
+Check whether a certain address is banned and not excepted
 ==================
 */
 
-static qboolean SV_IsBanned( netadr_t *from, qboolean isexception )
+static qboolean SV_IsBanned( netadr_t *from )
 {
-	int index;
-	serverBan_t *curban;
+	int flags;
 
-	if ( !serverBansCount ) {
+	if ( from->type != NA_IP ) {
 		return qfalse;
 	}
 
-	if ( !isexception )
-	{
-		// If this is a query for a ban, first check whether the client is excepted
-		if ( SV_IsBanned( from, qtrue ) )
-			return qfalse;
-	}
+	flags = IPTrie_Match( &serverBanTrie, NET_AdrToInt( *from ) );
 
-	for ( index = 0; index < serverBansCount; index++ )
-	{
-		curban = &serverBans[index];
-
-		if ( curban->isexception == isexception )
-		{
-			if ( NET_CompareBaseAdrMask( curban->ip, *from, curban->subnet ) )
-				return qtrue;
-		}
-	}
-
-	return qfalse;
+	return (qboolean)( ( flags & BANTRIE_BAN ) && !( flags & BANTRIE_EXCEPTION ) );
 }
 
 #define MAX_CONNECTING_PEOPLE_LOG	8
@@ -205,7 +188,7 @@ void SV_DirectConnect( netadr_t from ) {
 	Com_DPrintf ("SVC_DirectConnect ()\n");
 
 	// Check whether this client is banned.
-	if ( SV_IsBanned( &from, qfalse ) )
+	if ( SV_IsBanned( &from ) )
 	{
 		NET_OutOfBandPrint( NS_SERVER, from, "print\nYou are banned from this server.\n" );
 		Com_DPrintf( "    rejected connect from %s (banned)\n", NET_AdrToString(from) );
@@ -661,21 +644,22 @@ clear/free any download vars
 static void SV_CloseDownload( client_t *cl ) {
 	int i;
 
+	// Release the window's cache chunks
+	for (i = 0; i < MAX_DOWNLOAD_WINDOW; i++) {
+		if (cl->downloadChunks[i]) {
+			SV_ReleaseDownloadChunk( cl->downloadChunks[i] );
+			cl->downloadChunks[i] = NULL;
+		}
+		cl->downloadBlocks[i] = NULL;
+	}
+
 	// EOF
 	if (cl->download) {
-		FS_FCloseFile( cl->download );
+		SV_CloseDownloadFile( cl->download );
 	}
-	cl->download = 0;
+	cl->download = NULL;
 	*cl->downloadName = 0;
 
-	// Free the temporary buffer space
-	for (i = 0; i < MAX_DOWNLOAD_WINDOW; i++) {
-		if (cl->downloadBlocks[i]) {
-			Z_Free( cl->downloadBlocks[i] );
-			cl->downloadBlocks[i] = NULL;
-		}
-	}
-
 }
 
 /*
@@ -822,12 +806,12 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 			}
 		}
 
-		cl->download = 0;
+		cl->download = NULL;
 
 		// We open the file here
 		if ( !sv_allowDownload->integer ||
 			idPack || unreferenced ||
-			( cl->downloadSize = FS_SV_FOpenFileRead( cl->downloadName, &cl->download ) ) < 0 ) {
+			!( cl->download = SV_OpenDownloadFile( cl->downloadName, &cl->downloadSize ) ) ) {
 			// cannot auto-download file
 			if(unreferenced)
 			{
@@ -871,9 +855,6 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 
 			*cl->downloadName = 0;
 
-			if(cl->download)
-				FS_FCloseFile(cl->download);
-
 			return;
 		}
 
@@ -891,12 +872,16 @@ void SV_WriteDownloadToClient(client_t *cl, msg_t *msg)
 
 		curindex = (cl->downloadCurrentBlock % MAX_DOWNLOAD_WINDOW);
 
-		if (!cl->downloadBlocks[curindex])
-			cl->downloadBlocks[curindex] = (unsigned char *)Z_Malloc( MAX_DOWNLOAD_BLKSIZE, TAG_DOWNLOAD, qtrue );
+		// the block that used this slot has been acknowledged
+		if (cl->downloadChunks[curindex]) {
+			SV_ReleaseDownloadChunk( cl->downloadChunks[curindex] );
+			cl->downloadChunks[curindex] = NULL;
+		}
 
-		cl->downloadBlockSize[curindex] = FS_Read( cl->downloadBlocks[curindex], MAX_DOWNLOAD_BLKSIZE, cl->download );
+		cl->downloadBlockSize[curindex] = SV_ReadDownloadBlock( cl->download, cl->downloadCount,
+			&cl->downloadChunks[curindex], &cl->downloadBlocks[curindex] );
 
-		if (cl->downloadBlockSize[curindex] < 0) {
+		if (cl->downloadBlockSize[curindex] <= 0) {
 			// EOF right now
 			cl->downloadCount = cl->downloadSize;
 			break;
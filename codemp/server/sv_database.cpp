@@ -1,6 +1,14 @@
 #include "server.h"
 #include "sqlite3/sqlite3.h"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
 static const char* serverDBFileName = "enhanced_data.db";
 
 // global sqlite db handle
@@ -9,29 +17,376 @@ static sqlite3* db = nullptr;
 // internal queries for the generic key/value data store system
 
 static const char* sqlCreateDataTable =
-"CREATE TEMP TABLE IF NOT EXISTS [data] ("
+"CREATE TABLE IF NOT EXISTS [data] ("
 "    [key] TEXT NOT NULL,"
 "    [data] BLOB NOT NULL,"
 "    PRIMARY KEY ( [key] )"
 ");";
 
+// the data store lives in memory. with sv_dbPersistData set, the table is loaded
+// into it when the database is opened and written to (asynchronously) on changes
+static std::unordered_map<std::string, std::vector<byte>> dataStore;
+static std::vector<byte> removedData; // keeps the last removed entry valid until the next get
+static size_t dataStoreSize = 0;
+static size_t dataStorePeakSize = 0;
+static int dataStoreHits = 0;
+static int dataStoreMisses = 0;
+
 static dbStmt_t* insertDataStmt = nullptr;
-static dbStmt_t* retrieveDataStmt = nullptr;
 static dbStmt_t* deleteDataStmt = nullptr;
 
 static const char* sqlInsertData =
 "INSERT OR REPLACE INTO [data] ( key, data ) VALUES ( ?, ? )";
 
-static const char* sqlRetrieveData =
-"SELECT data FROM [data] WHERE ( key ) = ( ? )";
-
 static const char* sqlDeleteData =
 "DELETE FROM [data] WHERE ( key ) = ( ? )";
 
+static const char* sqlSelectAllData =
+"SELECT key, data FROM [data]";
+
+// errors of asynchronous requests are printed from the main thread along with the results
+static thread_local qboolean dbOnRequestThread = qfalse;
+
 static void SQLErrorCallback(void* userData, int code, const char* msg) {
+	if ( dbOnRequestThread ) {
+		return;
+	}
+
 	Com_Printf( "SQL error %d: %s\n", code, msg );
 }
 
+// asynchronous queries are executed in order by a single database thread, finished
+// requests are queued until the main thread passes their results to the game
+
+enum {
+	DB_BIND_NULL,
+	DB_BIND_INT64,
+	DB_BIND_DOUBLE,
+	DB_BIND_TEXT,
+	DB_BIND_BLOB
+};
+
+typedef struct dbBinding_s {
+	int colIndex;
+	int type;
+	int64_t intValue;
+	double doubleValue;
+	std::string data;
+} dbBinding_t;
+
+// what the handle of an async statement points to
+typedef struct dbAsyncStmt_s {
+	sqlite3_stmt* handle;
+	std::vector<dbBinding_t> bindings;
+} dbAsyncStmt_t;
+
+typedef struct dbRequest_s {
+	dbAsyncStmt_t* stmt; // null for plain sql
+	std::string sql;
+	std::vector<dbBinding_t> bindings;
+
+	DBResultCallback callback;
+	DBCompleteCallback complete;
+	void* userData;
+
+	// results, rows are stored one after the other
+	qboolean success;
+	std::string error;
+	std::vector<std::string> colNames;
+	std::vector<std::string> values;
+	std::vector<bool> nulls;
+} dbRequest_t;
+
+static std::thread* dbThread = nullptr;
+static std::mutex dbQueueLock;
+static std::condition_variable dbRequestReady;
+static std::condition_variable dbRequestsDone;
+// requests queued during a frame (or sv_dbBatchWindow) are executed in one transaction
+typedef std::vector<dbRequest_t*> dbBatch_t;
+
+static dbBatch_t dbBatch; // main thread only
+static int dbBatchStartTime;
+static std::deque<dbBatch_t> dbPending;
+static std::deque<dbRequest_t*> dbFinished;
+static int dbBusy = 0; // batches taken by the thread but not finished yet
+static qboolean dbQuit = qfalse;
+
+static void DB_BindAll( sqlite3_stmt* handle, const std::vector<dbBinding_t>& bindings ) {
+	for ( const dbBinding_t& b : bindings ) {
+		switch ( b.type ) {
+		case DB_BIND_INT64:
+			sqlite3_bind_int64( handle, b.colIndex, b.intValue );
+			break;
+		case DB_BIND_DOUBLE:
+			sqlite3_bind_double( handle, b.colIndex, b.doubleValue );
+			break;
+		case DB_BIND_TEXT:
+			sqlite3_bind_text( handle, b.colIndex, b.data.c_str(), -1, SQLITE_STATIC );
+			break;
+		case DB_BIND_BLOB:
+			sqlite3_bind_blob( handle, b.colIndex, b.data.data(), b.data.size(), SQLITE_STATIC );
+			break;
+		default:
+			sqlite3_bind_null( handle, b.colIndex );
+			break;
+		}
+	}
+}
+
+static void DB_AddResultRow( dbRequest_t* req, int numCols, char** colValues, char** colNames ) {
+	if ( req->colNames.empty() ) {
+		for ( int i = 0; i < numCols; ++i ) {
+			req->colNames.emplace_back( colNames[i] ? colNames[i] : "" );
+		}
+	}
+
+	for ( int i = 0; i < numCols; ++i ) {
+		req->values.emplace_back( colValues[i] ? colValues[i] : "" );
+		req->nulls.push_back( colValues[i] == nullptr );
+	}
+}
+
+static int DB_CollectExecRow( void* data, int numCols, char** colValues, char** colNames ) {
+	dbRequest_t* req = ( dbRequest_t* )data;
+
+	if ( req->callback ) {
+		DB_AddResultRow( req, numCols, colValues, colNames );
+	}
+
+	return 0;
+}
+
+// runs on the database thread
+static void DB_ExecuteRequest( dbRequest_t* req ) {
+	if ( !req->stmt ) {
+		char* errorMsg = nullptr;
+		int rc = sqlite3_exec( db, req->sql.c_str(), DB_CollectExecRow, req, &errorMsg );
+
+		if ( errorMsg ) {
+			req->error = errorMsg;
+			sqlite3_free( errorMsg );
+		}
+
+		req->success = rc == SQLITE_OK ? qtrue : qfalse;
+		return;
+	}
+
+	sqlite3_stmt* handle = req->stmt->handle;
+	int numCols = sqlite3_column_count( handle );
+	std::vector<char*> colNames( numCols + 1 );
+	std::vector<char*> colValues( numCols + 1 );
+	int rc;
+
+	sqlite3_reset( handle );
+	sqlite3_clear_bindings( handle );
+	DB_BindAll( handle, req->bindings );
+
+	while ( ( rc = sqlite3_step( handle ) ) == SQLITE_ROW ) {
+		if ( !req->callback ) {
+			continue;
+		}
+
+		for ( int i = 0; i < numCols; ++i ) {
+			colNames[i] = ( char* )sqlite3_column_name( handle, i );
+			colValues[i] = ( char* )sqlite3_column_text( handle, i );
+		}
+
+		DB_AddResultRow( req, numCols, colValues.data(), colNames.data() );
+	}
+
+	req->success = rc == SQLITE_DONE ? qtrue : qfalse;
+
+	if ( !req->success ) {
+		req->error = sqlite3_errstr( rc );
+	}
+
+	// don't keep pointers to the bound data around
+	sqlite3_reset( handle );
+	sqlite3_clear_bindings( handle );
+}
+
+static void DB_RequestThread() {
+	dbOnRequestThread = qtrue;
+
+	while ( true ) {
+		dbBatch_t batch;
+
+		{
+			std::unique_lock<std::mutex> l( dbQueueLock );
+
+			while ( dbPending.empty() && !dbQuit ) {
+				dbRequestReady.wait( l );
+			}
+
+			if ( dbPending.empty() ) {
+				break;
+			}
+
+			batch.swap( dbPending.front() );
+			dbPending.pop_front();
+			dbBusy++;
+		}
+
+		// one transaction means one sync to disk for the whole batch
+		qboolean transaction = batch.size() > 1 && sqlite3_exec( db, "BEGIN;", nullptr, nullptr, nullptr ) == SQLITE_OK ? qtrue : qfalse;
+
+		for ( dbRequest_t* req : batch ) {
+			DB_ExecuteRequest( req );
+		}
+
+		if ( transaction ) {
+			sqlite3_exec( db, "COMMIT;", nullptr, nullptr, nullptr );
+		}
+
+		{
+			std::lock_guard<std::mutex> l( dbQueueLock );
+			dbFinished.insert( dbFinished.end(), batch.begin(), batch.end() );
+			dbBusy--;
+		}
+
+		dbRequestsDone.notify_all();
+	}
+}
+
+// hands the requests queued so far to the database thread once the batch window has passed
+void SV_FlushDBBatch( qboolean force ) {
+	if ( dbBatch.empty() ) {
+		return;
+	}
+
+	if ( !force && Sys_Milliseconds() - dbBatchStartTime < sv_dbBatchWindow->integer ) {
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> l( dbQueueLock );
+		dbPending.emplace_back();
+		dbPending.back().swap( dbBatch );
+	}
+
+	dbRequestReady.notify_one();
+}
+
+// synchronous calls wait for the queued asynchronous requests first so they see their results
+static void DB_WaitForRequests() {
+	SV_FlushDBBatch( qtrue );
+
+	std::unique_lock<std::mutex> l( dbQueueLock );
+
+	while ( !dbPending.empty() || dbBusy ) {
+		dbRequestsDone.wait( l );
+	}
+}
+
+static qboolean DB_QueueRequest( dbRequest_t* req ) {
+	if ( !dbThread ) {
+		delete req;
+		return qfalse;
+	}
+
+	if ( dbBatch.empty() ) {
+		dbBatchStartTime = Sys_Milliseconds();
+	}
+
+	dbBatch.push_back( req );
+	return qtrue;
+}
+
+static void DB_RunCallbacks( dbRequest_t* req ) {
+	if ( !req->error.empty() ) {
+		Com_Printf( "SQL error: %s\n", req->error.c_str() );
+
+		if ( !req->stmt ) {
+			Com_Printf( "Query: %s\n", req->sql.c_str() );
+		}
+	}
+
+	if ( req->callback && !req->colNames.empty() ) {
+		size_t numCols = req->colNames.size();
+		const char** colNames = ( const char** )Frame_Alloc( sizeof( char* ) * numCols );
+		const char** colValues = ( const char** )Frame_Alloc( sizeof( char* ) * numCols );
+
+		for ( size_t i = 0; i < numCols; ++i ) {
+			colNames[i] = req->colNames[i].c_str();
+		}
+
+		for ( size_t row = 0; row < req->values.size(); row += numCols ) {
+			for ( size_t i = 0; i < numCols; ++i ) {
+				colValues[i] = req->nulls[row + i] ? nullptr : req->values[row + i].c_str();
+			}
+
+			if ( !req->callback( ( int )numCols, colNames, colValues, req->userData ) ) {
+				break;
+			}
+		}
+	}
+
+	if ( req->complete ) {
+		req->complete( req->success, req->userData );
+	}
+}
+
+void SV_RunDBCallbacks() {
+	std::deque<dbRequest_t*> finished;
+
+	{
+		std::lock_guard<std::mutex> l( dbQueueLock );
+		finished.swap( dbFinished );
+	}
+
+	for ( dbRequest_t* req : finished ) {
+		DB_RunCallbacks( req );
+		delete req;
+	}
+}
+
+// waits for all queued requests, then either passes their results to the game or drops them
+void SV_FinishDBRequests( qboolean runCallbacks ) {
+	DB_WaitForRequests();
+
+	if ( runCallbacks ) {
+		SV_RunDBCallbacks();
+		return;
+	}
+
+	std::lock_guard<std::mutex> l( dbQueueLock );
+
+	for ( dbRequest_t* req : dbFinished ) {
+		delete req;
+	}
+
+	dbFinished.clear();
+}
+
+static void DB_LoadDataStore() {
+	sqlite3_stmt* statement;
+
+	if ( sqlite3_prepare_v2( db, sqlSelectAllData, -1, &statement, nullptr ) != SQLITE_OK ) {
+		return;
+	}
+
+	while ( sqlite3_step( statement ) == SQLITE_ROW ) {
+		const char* key = ( const char* )sqlite3_column_text( statement, 0 );
+		const byte* data = ( const byte* )sqlite3_column_blob( statement, 1 );
+		int size = sqlite3_column_bytes( statement, 1 );
+
+		if ( !key ) {
+			continue;
+		}
+
+		std::vector<byte>& entry = dataStore[key];
+		dataStoreSize -= entry.size();
+		entry.assign( data, data + size );
+		dataStoreSize += size;
+	}
+
+	sqlite3_finalize( statement );
+
+	if ( dataStoreSize > dataStorePeakSize ) {
+		dataStorePeakSize = dataStoreSize;
+	}
+}
+
 void SV_InitDB() {
     if ( db ) {
         return;
@@ -39,7 +394,8 @@ void SV_InitDB() {
 
 	// general configuration
 	sqlite3_config( SQLITE_CONFIG_LOG, SQLErrorCallback, nullptr );
-	sqlite3_config( SQLITE_CONFIG_SINGLETHREAD );
+	// the connection is shared with the database thread
+	sqlite3_config( SQLITE_CONFIG_SERIALIZED );
 
     int rc;
 
@@ -57,24 +413,55 @@ void SV_InitDB() {
 	// enable foreign key support
 	SV_ExecDBQuery( "PRAGMA foreign_keys = ON;", nullptr, nullptr );
 
+	// with WAL, readers don't block the writer and commits only append to the log
+	if ( sv_dbWAL->integer ) {
+		SV_ExecDBQuery( "PRAGMA journal_mode = WAL;", nullptr, nullptr );
+	}
+
+	SV_ExecDBQuery( va( "PRAGMA synchronous = %d;", Com_Clampi( 0, 3, sv_dbSynchronous->integer ) ), nullptr, nullptr );
+
 	// prepare the key/value data store table and statements
 
 	SV_ExecDBQuery( sqlCreateDataTable, nullptr, nullptr );
-	insertDataStmt = SV_CreateDBStatement( sqlInsertData );
-	retrieveDataStmt = SV_CreateDBStatement( sqlRetrieveData );
-	deleteDataStmt = SV_CreateDBStatement( sqlDeleteData );
+	insertDataStmt = SV_CreateDBAsyncStatement( sqlInsertData );
+	deleteDataStmt = SV_CreateDBAsyncStatement( sqlDeleteData );
+
+	if ( sv_dbPersistData->integer ) {
+		DB_LoadDataStore();
+	}
+
+	dbQuit = qfalse;
+	dbThread = new std::thread( DB_RequestThread );
 
     Com_Printf( "Loaded database file successfully\n" );
 }
 
 void SV_CloseDB() {
+	if ( dbThread ) {
+		// the thread executes what's left in the queue before quitting
+		SV_FlushDBBatch( qtrue );
+
+		{
+			std::lock_guard<std::mutex> l( dbQueueLock );
+			dbQuit = qtrue;
+		}
+		dbRequestReady.notify_one();
+		dbThread->join();
+		delete dbThread;
+		dbThread = nullptr;
+		SV_FinishDBRequests( qfalse );
+	}
+
 	SV_FreeDBStatement( insertDataStmt );
-	SV_FreeDBStatement( retrieveDataStmt );
 	SV_FreeDBStatement( deleteDataStmt );
 	insertDataStmt = nullptr;
-	retrieveDataStmt = nullptr;
 	deleteDataStmt = nullptr;
 
+	// persisted entries are loaded again when the database is reopened
+	dataStore.clear();
+	removedData.clear();
+	dataStoreSize = 0;
+
     if ( db ) {
         sqlite3_close( db );
         db = nullptr;
@@ -106,6 +493,8 @@ qboolean SV_ExecDBQuery( const char* sql, DBResultCallback callback, void* userD
         return qfalse;
     }
 
+	DB_WaitForRequests();
+
 	proxyUserData_t proxyUserData;
 	proxyUserData.actualCallback = callback;
 	proxyUserData.actualUserData = userData;
@@ -154,6 +543,8 @@ static qboolean BindNull_Internal( dbStmt_t* stmt, int colIndex ) {
 }
 
 static qboolean Step_Internal( dbStmt_t* stmt ) {
+	DB_WaitForRequests();
+
 	int rc = sqlite3_step( ( sqlite3_stmt* )( stmt->handle ) );
 
 	if ( rc == SQLITE_ROW ) {
@@ -172,17 +563,18 @@ static qboolean StepAll_Internal( dbStmt_t* stmt, DBResultCallback callback, voi
 	int rc;
 	sqlite3_stmt* handle = ( sqlite3_stmt* )stmt->handle;
 
+	DB_WaitForRequests();
+
+	int numCols = sqlite3_column_count( handle );
+	const char** colNames = ( const char** )Frame_Alloc( sizeof( char* ) * numCols );
+	const char** colValues = ( const char** )Frame_Alloc( sizeof( char* ) * numCols );
+
 	while ( ( rc = sqlite3_step( handle ) ) == SQLITE_ROW ) {
 		if ( !callback ) {
 			continue;
 		}
 
-		int numCols = sqlite3_column_count( handle );
-
 		if ( numCols ) {
-			const char** colNames = ( const char** )Z_Malloc( sizeof( char* ) * numCols, TAG_GENERAL );
-			const char** colValues = ( const char** )Z_Malloc( sizeof( char* ) * numCols, TAG_GENERAL );
-
 			for ( int i = 0; i < numCols; ++i ) {
 				colNames[i] = sqlite3_column_name( handle, i );
 				colValues[i] = ( const char* )sqlite3_column_text( handle, i + 1 );
@@ -190,9 +582,6 @@ static qboolean StepAll_Internal( dbStmt_t* stmt, DBResultCallback callback, voi
 
 			qboolean doContinue = callback( numCols, colNames, colValues, userData );
 
-			Z_Free( colNames );
-			Z_Free( colValues );
-
 			if ( !doContinue ) {
 				rc = SQLITE_ABORT;
 				break;
@@ -248,7 +637,109 @@ static void Clear_Internal( dbStmt_t* stmt ) {
 	sqlite3_clear_bindings( ( sqlite3_stmt* )( stmt->handle ) );
 }
 
-dbStmt_t* SV_CreateDBStatement( const char* sql ) {
+// interfaces for async statements, bindings are kept until the statement is executed
+
+static void AsyncBind( dbStmt_t* stmt, int colIndex, int type, int64_t intValue, double doubleValue, const void* data, size_t size ) {
+	std::vector<dbBinding_t>& bindings = ( ( dbAsyncStmt_t* )stmt->handle )->bindings;
+	dbBinding_t* b = nullptr;
+
+	for ( dbBinding_t& existing : bindings ) {
+		if ( existing.colIndex == colIndex ) {
+			b = &existing;
+			break;
+		}
+	}
+
+	if ( !b ) {
+		bindings.emplace_back();
+		b = &bindings.back();
+		b->colIndex = colIndex;
+	}
+
+	b->type = type;
+	b->intValue = intValue;
+	b->doubleValue = doubleValue;
+	b->data.assign( data ? ( const char* )data : "", data ? size : 0 );
+}
+
+static qboolean AsyncBindString_Internal( dbStmt_t* stmt, int colIndex, const char* value ) {
+	if ( !value ) {
+		AsyncBind( stmt, colIndex, DB_BIND_NULL, 0, 0, nullptr, 0 );
+	} else {
+		AsyncBind( stmt, colIndex, DB_BIND_TEXT, 0, 0, value, strlen( value ) );
+	}
+	return qtrue;
+}
+
+static qboolean AsyncBindInt32_Internal( dbStmt_t* stmt, int colIndex, int32_t value ) {
+	AsyncBind( stmt, colIndex, DB_BIND_INT64, value, 0, nullptr, 0 );
+	return qtrue;
+}
+
+static qboolean AsyncBindInt64_Internal( dbStmt_t* stmt, int colIndex, int64_t value ) {
+	AsyncBind( stmt, colIndex, DB_BIND_INT64, value, 0, nullptr, 0 );
+	return qtrue;
+}
+
+static qboolean AsyncBindDouble_Internal( dbStmt_t* stmt, int colIndex, double value ) {
+	AsyncBind( stmt, colIndex, DB_BIND_DOUBLE, 0, value, nullptr, 0 );
+	return qtrue;
+}
+
+static qboolean AsyncBindBlob_Internal( dbStmt_t* stmt, int colIndex, void* value, size_t size ) {
+	AsyncBind( stmt, colIndex, DB_BIND_BLOB, 0, 0, value, size );
+	return qtrue;
+}
+
+static qboolean AsyncBindNull_Internal( dbStmt_t* stmt, int colIndex ) {
+	AsyncBind( stmt, colIndex, DB_BIND_NULL, 0, 0, nullptr, 0 );
+	return qtrue;
+}
+
+static qboolean AsyncStep_Internal( dbStmt_t* stmt ) {
+	Com_Printf( "Async SQL statements can't be stepped, use DB_ExecStatementAsync\n" );
+	return qfalse;
+}
+
+static qboolean AsyncStepAll_Internal( dbStmt_t* stmt, DBResultCallback callback, void* userData ) {
+	return AsyncStep_Internal( stmt );
+}
+
+static const char* AsyncGetString_Internal( dbStmt_t* stmt, int colIndex ) {
+	return nullptr;
+}
+
+static int32_t AsyncGetInt32_Internal( dbStmt_t* stmt, int colIndex ) {
+	return 0;
+}
+
+static int64_t AsyncGetInt64_Internal( dbStmt_t* stmt, int colIndex ) {
+	return 0;
+}
+
+static double AsyncGetDouble_Internal( dbStmt_t* stmt, int colIndex ) {
+	return 0;
+}
+
+static const void* AsyncGetBlob_Internal( dbStmt_t* stmt, int colIndex, size_t* outSize ) {
+	if ( outSize ) {
+		*outSize = 0;
+	}
+
+	return nullptr;
+}
+
+static void AsyncClear_Internal( dbStmt_t* stmt ) {
+	( ( dbAsyncStmt_t* )stmt->handle )->bindings.clear();
+}
+
+static void AsyncReset_Internal( dbStmt_t* stmt, qboolean clearBindings ) {
+	if ( clearBindings ) {
+		stmt->Clear( stmt );
+	}
+}
+
+static sqlite3_stmt* PrepareStatement( const char* sql ) {
 	if ( !db ) {
 		return nullptr;
 	}
@@ -261,8 +752,80 @@ dbStmt_t* SV_CreateDBStatement( const char* sql ) {
 		return nullptr;
 	}
 
+	return statement; // this can be null when an empty sql string is passed
+}
+
+dbStmt_t* SV_CreateDBAsyncStatement( const char* sql ) {
+	sqlite3_stmt* statement = PrepareStatement( sql );
+
 	if ( !statement ) {
-		return nullptr; // this can happen when an empty sql string is passed
+		return nullptr;
+	}
+
+	dbAsyncStmt_t* asyncStmt = new dbAsyncStmt_t;
+	asyncStmt->handle = statement;
+
+	dbStmt_t* result = ( dbStmt_t* )Z_Malloc( sizeof( dbStmt_t ), TAG_GENERAL );
+	result->handle = asyncStmt;
+
+	result->BindString = AsyncBindString_Internal;
+	result->BindInt32 = AsyncBindInt32_Internal;
+	result->BindInt64 = AsyncBindInt64_Internal;
+	result->BindBool = BindBool_Internal;
+	result->BindDouble = AsyncBindDouble_Internal;
+	result->BindBlob = AsyncBindBlob_Internal;
+	result->BindNull = AsyncBindNull_Internal;
+	result->Step = AsyncStep_Internal;
+	result->StepAll = AsyncStepAll_Internal;
+	result->GetString = AsyncGetString_Internal;
+	result->GetInt32 = AsyncGetInt32_Internal;
+	result->GetInt64 = AsyncGetInt64_Internal;
+	result->GetBool = GetBool_Internal;
+	result->GetDouble = AsyncGetDouble_Internal;
+	result->GetBlob = AsyncGetBlob_Internal;
+	result->Reset = AsyncReset_Internal;
+	result->Clear = AsyncClear_Internal;
+
+	return result;
+}
+
+qboolean SV_ExecDBStatementAsync( dbStmt_t* stmt, DBResultCallback callback, DBCompleteCallback complete, void* userData ) {
+	if ( !stmt || stmt->Step != AsyncStep_Internal ) {
+		Com_Printf( "SV_ExecDBStatementAsync: not an async statement\n" );
+		return qfalse;
+	}
+
+	dbAsyncStmt_t* asyncStmt = ( dbAsyncStmt_t* )stmt->handle;
+	dbRequest_t* req = new dbRequest_t();
+	req->stmt = asyncStmt;
+	req->bindings.swap( asyncStmt->bindings );
+	req->callback = callback;
+	req->complete = complete;
+	req->userData = userData;
+
+	return DB_QueueRequest( req );
+}
+
+qboolean SV_ExecDBQueryAsync( const char* sql, DBResultCallback callback, DBCompleteCallback complete, void* userData ) {
+	if ( !sql ) {
+		return qfalse;
+	}
+
+	dbRequest_t* req = new dbRequest_t();
+	req->stmt = nullptr;
+	req->sql = sql;
+	req->callback = callback;
+	req->complete = complete;
+	req->userData = userData;
+
+	return DB_QueueRequest( req );
+}
+
+dbStmt_t* SV_CreateDBStatement( const char* sql ) {
+	sqlite3_stmt* statement = PrepareStatement( sql );
+
+	if ( !statement ) {
+		return nullptr;
 	}
 
 	// prepare the statement wrapper and return it
@@ -296,7 +859,14 @@ void SV_FreeDBStatement( dbStmt_t* stmt ) {
 		return;
 	}
 
-	if ( stmt->handle ) {
+	// queued requests may still use the statement
+	DB_WaitForRequests();
+
+	if ( stmt->Step == AsyncStep_Internal ) {
+		dbAsyncStmt_t* asyncStmt = ( dbAsyncStmt_t* )stmt->handle;
+		sqlite3_finalize( asyncStmt->handle );
+		delete asyncStmt;
+	} else if ( stmt->handle ) {
 		sqlite3_finalize( ( sqlite3_stmt* )stmt->handle );
 	}
 
@@ -304,41 +874,77 @@ void SV_FreeDBStatement( dbStmt_t* stmt ) {
 }
 
 void SV_SetDBData( const char* name, void* data, size_t size ) {
-	if ( !insertDataStmt ) {
-		return;
+	std::vector<byte>& entry = dataStore[name];
+
+	dataStoreSize -= entry.size();
+	entry.assign( ( byte* )data, ( byte* )data + size );
+	dataStoreSize += size;
+
+	if ( dataStoreSize > dataStorePeakSize ) {
+		dataStorePeakSize = dataStoreSize;
 	}
 
-	insertDataStmt->BindString( insertDataStmt, 1, name );
-	insertDataStmt->BindBlob( insertDataStmt, 2, data, size );
-	insertDataStmt->Step( insertDataStmt );
-	insertDataStmt->Reset( insertDataStmt, qtrue );
+	if ( sv_dbPersistData->integer && insertDataStmt ) {
+		insertDataStmt->BindString( insertDataStmt, 1, name );
+		insertDataStmt->BindBlob( insertDataStmt, 2, data, size );
+		SV_ExecDBStatementAsync( insertDataStmt, nullptr, nullptr, nullptr );
+	}
 }
 
+// the returned pointer stays valid until the entry is set again or removed, and
+// for removed entries until the next call
 const void* SV_GetDBData( const char* name, size_t* outSize, qboolean remove ) {
-	if ( !retrieveDataStmt || !deleteDataStmt ) {
+	if ( outSize ) {
+		*outSize = 0;
+	}
+
+	auto it = dataStore.find( name );
+
+	if ( it == dataStore.end() ) {
+		dataStoreMisses++;
 		return nullptr;
 	}
 
-	// reset at the beginning so that the returned pointer is valid until the function is called again
-	retrieveDataStmt->Reset( retrieveDataStmt, qtrue );
+	dataStoreHits++;
 
-	const void* result = nullptr;
+	std::vector<byte>* entry = &it->second;
+
+	if ( remove ) {
+		removedData.swap( it->second );
+		dataStoreSize -= removedData.size();
+		dataStore.erase( it );
+		entry = &removedData;
+
+		if ( sv_dbPersistData->integer && deleteDataStmt ) {
+			deleteDataStmt->BindString( deleteDataStmt, 1, name );
+			SV_ExecDBStatementAsync( deleteDataStmt, nullptr, nullptr, nullptr );
+		}
+	}
 
 	if ( outSize ) {
-		*outSize = 0;
+		*outSize = entry->size();
 	}
 
-	retrieveDataStmt->BindString( retrieveDataStmt, 1, name );
+	return entry->empty() ? nullptr : entry->data();
+}
 
-	if ( retrieveDataStmt->Step( retrieveDataStmt ) ) {
-		result = retrieveDataStmt->GetBlob( retrieveDataStmt, 0, outSize );
+void SV_DBInfo_f( void ) {
+	size_t pending = dbBatch.size();
+	int busy;
 
-		if ( remove ) {
-			deleteDataStmt->BindString( deleteDataStmt, 1, name );
-			deleteDataStmt->Step( deleteDataStmt );
-			deleteDataStmt->Reset( deleteDataStmt, qtrue );
+	{
+		std::lock_guard<std::mutex> l( dbQueueLock );
+
+		for ( const dbBatch_t& batch : dbPending ) {
+			pending += batch.size();
 		}
+
+		busy = dbBusy;
 	}
 
-	return result;
-}
\ No newline at end of file
+	Com_Printf( "Database: %s\n", db ? serverDBFileName : "not loaded" );
+	Com_Printf( "Async requests: %i queued, %s\n", ( int )pending, busy ? "executing a batch" : "idle" );
+	Com_Printf( "Data store: %i entries, %i bytes (peak %i bytes), %i hits, %i misses%s\n",
+		( int )dataStore.size(), ( int )dataStoreSize, ( int )dataStorePeakSize, dataStoreHits, dataStoreMisses,
+		sv_dbPersistData->integer ? ", persisted" : "" );
+}
@@ -0,0 +1,323 @@
+#include "server.h"
+
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/*
+=============================================================================
+
+Shared download cache
+
+Files offered for download are read in DOWNLOAD_CHUNK_SIZE chunks that are
+shared by every client downloading the same file. A client's download window
+points into these chunks instead of holding its own copies, so twenty clients
+fetching a freshly released map cost one read stream and one set of buffers.
+
+Chunks referenced by a window stay loaded. Unreferenced chunks are kept in
+least recently used order up to sv_downloadCacheSize, so clients that are a
+little behind each other still find their data in memory.
+
+=============================================================================
+*/
+
+#define DOWNLOAD_CHUNK_SIZE		(64 * 1024)	// a multiple of MAX_DOWNLOAD_BLKSIZE
+
+struct downloadChunk_s {
+	downloadFile_t					*file;
+	int								index;
+	int								size;
+	int								refs;
+	std::list<downloadChunk_t*>::iterator	idle;	// position in downloadIdleChunks while unreferenced
+	byte							data[1];
+};
+
+struct downloadFile_s {
+	std::string						name;
+	fileHandle_t					handle;			// only open while clients download the file
+	int								size;
+	int64_t							mtime;			// chunks are dropped if the file changes
+	int								refs;
+	std::unordered_map<int, downloadChunk_t*>	chunks;
+};
+
+static std::unordered_map<std::string, downloadFile_t*> downloadFiles;
+static std::list<downloadChunk_t*> downloadIdleChunks;		// most recently used first
+static std::unordered_set<downloadChunk_t*> downloadOrphans;	// of files that changed, still in a window
+
+static struct {
+	int		cachedBytes;
+	int		hits;
+	int		misses;
+	int64_t	bytesRead;
+	int64_t	bytesServed;
+} downloadStats;
+
+/*
+==================
+SV_FreeDownloadFile
+==================
+*/
+static void SV_FreeDownloadFile( downloadFile_t *file ) {
+	if ( file->handle ) {
+		FS_FCloseFile( file->handle );
+	}
+	downloadFiles.erase( file->name );
+	delete file;
+}
+
+/*
+==================
+SV_FreeDownloadChunk
+==================
+*/
+static void SV_FreeDownloadChunk( downloadChunk_t *chunk ) {
+	downloadFile_t *file = chunk->file;
+
+	file->chunks.erase( chunk->index );
+	downloadStats.cachedBytes -= chunk->size;
+	Z_Free( chunk );
+
+	if ( !file->refs && file->chunks.empty() ) {
+		SV_FreeDownloadFile( file );
+	}
+}
+
+/*
+==================
+SV_TrimDownloadCache
+
+Drop the least recently used unreferenced chunks until the cache fits its budget
+==================
+*/
+static void SV_TrimDownloadCache( void ) {
+	int budget = Q_max( sv_downloadCacheSize->integer, 0 ) * 1024;
+
+	while ( downloadStats.cachedBytes > budget && !downloadIdleChunks.empty() ) {
+		downloadChunk_t *chunk = downloadIdleChunks.back();
+
+		downloadIdleChunks.pop_back();
+		SV_FreeDownloadChunk( chunk );
+	}
+}
+
+/*
+==================
+SV_OpenDownloadFile
+
+Returns the shared state of a file to download, opening it if no one else is
+downloading it. Returns NULL if the file can't be opened.
+==================
+*/
+downloadFile_t *SV_OpenDownloadFile( const char *name, int *size ) {
+	char key[MAX_QPATH];
+	downloadFile_t *file;
+
+	Q_strncpyz( key, name, sizeof( key ) );
+	Q_strlwr( key );
+
+	auto it = downloadFiles.find( key );
+	if ( it != downloadFiles.end() ) {
+		file = it->second;
+	} else {
+		file = new downloadFile_t;
+		file->name = key;
+		file->handle = 0;
+		file->size = 0;
+		file->mtime = -1;
+		file->refs = 0;
+		downloadFiles[key] = file;
+	}
+
+	if ( !file->handle ) {
+		int fileSize = FS_SV_FOpenFileRead( name, &file->handle );
+		int64_t mtime;
+
+		if ( fileSize < 0 || !file->handle ) {
+			file->handle = 0;
+			if ( !file->refs && file->chunks.empty() ) {
+				SV_FreeDownloadFile( file );
+			}
+			return NULL;
+		}
+
+		// the file changed since its chunks were cached, a replacement may well
+		// have the same size
+		mtime = FS_FileModificationTime( file->handle );
+		if ( ( fileSize != file->size || mtime != file->mtime || mtime == -1 ) && !file->chunks.empty() ) {
+			for ( auto &c : file->chunks ) {
+				if ( c.second->refs ) {
+					// still in someone's window, orphan it so it is freed on release
+					c.second->file = NULL;
+					downloadOrphans.insert( c.second );
+				} else {
+					downloadIdleChunks.erase( c.second->idle );
+					downloadStats.cachedBytes -= c.second->size;
+					Z_Free( c.second );
+				}
+			}
+			file->chunks.clear();
+		}
+		file->size = fileSize;
+		file->mtime = mtime;
+	}
+
+	file->refs++;
+	*size = file->size;
+
+	return file;
+}
+
+/*
+==================
+SV_CloseDownloadFile
+==================
+*/
+void SV_CloseDownloadFile( downloadFile_t *file ) {
+	if ( --file->refs > 0 ) {
+		return;
+	}
+
+	// keep the cached chunks for the next client, but not the handle
+	if ( file->handle ) {
+		FS_FCloseFile( file->handle );
+		file->handle = 0;
+	}
+
+	if ( file->chunks.empty() ) {
+		SV_FreeDownloadFile( file );
+	}
+}
+
+/*
+==================
+SV_ReadDownloadBlock
+
+Points *data at the download block starting at offset and takes a reference on
+the chunk holding it, which the caller releases with SV_ReleaseDownloadChunk.
+Returns the size of the block, or -1 on a read error.
+==================
+*/
+int SV_ReadDownloadBlock( downloadFile_t *file, int offset, downloadChunk_t **chunk, const byte **data ) {
+	int index = offset / DOWNLOAD_CHUNK_SIZE;
+	downloadChunk_t *c;
+
+	auto it = file->chunks.find( index );
+	if ( it != file->chunks.end() ) {
+		c = it->second;
+		if ( !c->refs ) {
+			downloadIdleChunks.erase( c->idle );
+		}
+		downloadStats.hits++;
+	} else {
+		int size = Q_min( DOWNLOAD_CHUNK_SIZE, file->size - index * DOWNLOAD_CHUNK_SIZE );
+
+		if ( size <= 0 || FS_Seek( file->handle, index * DOWNLOAD_CHUNK_SIZE, FS_SEEK_SET ) ) {
+			return -1;
+		}
+
+		c = (downloadChunk_t *)Z_Malloc( sizeof( downloadChunk_t ) + size, TAG_DOWNLOAD, qfalse );
+		new ( &c->idle ) std::list<downloadChunk_t*>::iterator();
+		c->file = file;
+		c->index = index;
+		c->refs = 0;
+		c->size = FS_Read( c->data, size, file->handle );
+
+		if ( c->size <= 0 ) {
+			Z_Free( c );
+			return -1;
+		}
+
+		file->chunks[index] = c;
+		downloadStats.cachedBytes += c->size;
+		downloadStats.bytesRead += c->size;
+		downloadStats.misses++;
+	}
+
+	c->refs++;
+	*chunk = c;
+
+	offset -= index * DOWNLOAD_CHUNK_SIZE;
+	*data = c->data + offset;
+
+	int size = Q_max( Q_min( MAX_DOWNLOAD_BLKSIZE, c->size - offset ), 0 );
+	downloadStats.bytesServed += size;
+
+	return size;
+}
+
+/*
+==================
+SV_ReleaseDownloadChunk
+==================
+*/
+void SV_ReleaseDownloadChunk( downloadChunk_t *chunk ) {
+	if ( --chunk->refs > 0 ) {
+		return;
+	}
+
+	if ( !chunk->file ) {
+		downloadOrphans.erase( chunk );
+		Z_Free( chunk );
+		return;
+	}
+
+	downloadIdleChunks.push_front( chunk );
+	chunk->idle = downloadIdleChunks.begin();
+
+	SV_TrimDownloadCache();
+}
+
+/*
+==================
+SV_ShutdownDownloads
+
+Frees the whole cache, any client still downloading must be gone by now
+==================
+*/
+void SV_ShutdownDownloads( void ) {
+	for ( auto &f : downloadFiles ) {
+		for ( auto &c : f.second->chunks ) {
+			Z_Free( c.second );
+		}
+		if ( f.second->handle ) {
+			FS_FCloseFile( f.second->handle );
+		}
+		delete f.second;
+	}
+
+	for ( auto c : downloadOrphans ) {
+		Z_Free( c );
+	}
+
+	downloadFiles.clear();
+	downloadIdleChunks.clear();
+	downloadOrphans.clear();
+	downloadStats.cachedBytes = 0;
+}
+
+/*
+==================
+SV_DownloadInfo_f
+==================
+*/
+void SV_DownloadInfo_f( void ) {
+	int idleBytes = 0;
+
+	for ( auto c : downloadIdleChunks ) {
+		idleBytes += c->size;
+	}
+
+	Com_Printf( "Download cache: %d files, %.2f MB cached (%.2f MB unreferenced), budget %d KB\n",
+		(int)downloadFiles.size(), downloadStats.cachedBytes / ( 1024.0f * 1024.0f ),
+		idleBytes / ( 1024.0f * 1024.0f ), sv_downloadCacheSize->integer );
+	Com_Printf( "%d chunk hits, %d misses, %.2f MB read from disk for %.2f MB served\n",
+		downloadStats.hits, downloadStats.misses,
+		downloadStats.bytesRead / ( 1024.0 * 1024.0 ), downloadStats.bytesServed / ( 1024.0 * 1024.0 ) );
+
+	for ( auto &f : downloadFiles ) {
+		Com_Printf( "%s: %d downloading, %d chunks cached\n",
+			f.second->name.c_str(), f.second->refs, (int)f.second->chunks.size() );
+	}
+}
@@ -58,7 +58,11 @@ void GVM_ShutdownGame( int restart ) {
 	}
 	VMSwap v( gvm );
 
+	// let the game have the results of its pending queries, and make sure
+	// nothing calls back into it once it's gone
+	SV_FinishDBRequests( qtrue );
 	ge->ShutdownGame( restart );
+	SV_FinishDBRequests( qfalse );
 }
 
 char *GVM_ClientConnect( int clientNum, qboolean firstTime, qboolean isBot ) {
@@ -1750,6 +1754,10 @@ static void GVM_Cvar_Set( const char *var_name, const char *value ) {
 	Cvar_VM_Set( var_name, value, VM_GAME );
 }
 
+static int GVM_FS_FileTime( fileHandle_t f ) {
+	return (int)FS_FileModificationTime( f );
+}
+
 // legacy syscall
 
 intptr_t SV_GameSystemCalls( intptr_t *args ) {
@@ -2822,6 +2830,7 @@ void SV_BindGame( void ) {
 		gi.Cvar_Register						= Cvar_Register;
 		gi.Cvar_Set								= GVM_Cvar_Set;
 		gi.Cvar_Update							= Cvar_Update;
+		gi.Cvar_ModificationCount				= Cvar_ModificationCount;
 		gi.Cvar_VariableIntegerValue			= Cvar_VariableIntegerValue;
 		gi.Cvar_VariableStringBuffer			= Cvar_VariableStringBuffer;
 		gi.Argc									= Cmd_Argc;
@@ -2831,6 +2840,7 @@ void SV_BindGame( void ) {
 		gi.FS_Open								= FS_FOpenFileByMode;
 		gi.FS_Read								= FS_Read;
 		gi.FS_Write								= FS_Write;
+		gi.FS_FileTime							= GVM_FS_FileTime;
 		gi.AdjustAreaPortalState				= SV_AdjustAreaPortalState;
 		gi.AreasConnected						= CM_AreasConnected;
 		gi.DebugPolygonCreate					= BotImport_DebugPolygonCreate;
@@ -2840,6 +2850,7 @@ void SV_BindGame( void ) {
 		gi.EntityContact						= SV_EntityContact;
 		gi.Trace								= SV_Trace;
 		gi.GetConfigstring						= SV_GetConfigstring;
+		gi.FindConfigstringIndex				= SV_FindConfigstringIndex;
 		gi.GetEntityToken						= SV_GetEntityToken;
 		gi.GetServerinfo						= SV_GetServerinfo;
 		gi.GetUsercmd							= SV_GetUsercmd;
@@ -3127,6 +3138,9 @@ void SV_BindGame( void ) {
 		gi.DB_FreeStatement						= SV_FreeDBStatement;
 		gi.DB_SetData							= SV_SetDBData;
 		gi.DB_GetData							= SV_GetDBData;
+		gi.DB_CreateAsyncStatement				= SV_CreateDBAsyncStatement;
+		gi.DB_ExecStatementAsync				= SV_ExecDBStatementAsync;
+		gi.DB_ExecQueryAsync					= SV_ExecDBQueryAsync;
 
 		// crypto
 		gi.Crypto_GenerateKeys					= SV_GenerateCryptoKeys;
@@ -3136,6 +3150,9 @@ void SV_BindGame( void ) {
 		gi.Crypto_DecryptString					= SV_DecryptString;
 		gi.Crypto_Hash							= SV_CryptoHash;
 
+		// memory
+		gi.Frame_Alloc							= Frame_Alloc;
+
 		GetGameAPI = (GetGameAPI_t)gvm->GetModuleAPI;
 		ret = GetGameAPI( GAME_API_VERSION, &gi );
 		if ( !ret ) {
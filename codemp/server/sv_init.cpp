@@ -103,6 +103,189 @@ void SV_UpdateConfigstrings(client_t *client)
 	}
 }
 
+/*
+===============
+SV_SendChangedConfigstrings
+
+Sends an active client the configstrings changed so far this frame. Called at
+the end of the frame, and before any other reliable command goes to the client
+so it never sees a command ahead of the configstrings set before it.
+===============
+*/
+void SV_SendChangedConfigstrings( client_t *client )
+{
+	int i, index;
+
+	// cleared first, sending the configstrings comes back through SV_AddServerCommand
+	client->csPending = qfalse;
+
+	for ( i = 0; i < sv.numChangedConfigstrings; i++ ) {
+		index = sv.changedConfigstrings[i];
+		if ( !client->csUpdated[index] ) {
+			continue;
+		}
+		client->csUpdated[index] = qfalse;
+		SV_SendConfigstring( client, index );
+		svs.configstringSends++;
+	}
+}
+
+/*
+===============
+SV_FlushConfigstrings
+
+Sends the configstrings changed this frame to every active client
+===============
+*/
+void SV_FlushConfigstrings( void )
+{
+	int i;
+	client_t *client;
+
+	if ( !sv.numChangedConfigstrings ) {
+		return;
+	}
+
+	for ( i = 0, client = svs.clients; i < sv_maxclients->integer; i++, client++ ) {
+		if ( client->state == CS_ACTIVE && client->csPending ) {
+			SV_SendChangedConfigstrings( client );
+		}
+	}
+
+	for ( i = 0; i < sv.numChangedConfigstrings; i++ ) {
+		sv.configstringChanged[sv.changedConfigstrings[i]] = qfalse;
+	}
+	sv.numChangedConfigstrings = 0;
+}
+
+/*
+===============
+SV_ConfigstringInfo_f
+===============
+*/
+void SV_ConfigstringInfo_f( void )
+{
+	int total = svs.configstringSends + svs.configstringSendsCoalesced;
+
+	Com_Printf( "%d configstring updates sent, %d coalesced into a later update of the same frame (%.1f%%)\n",
+		svs.configstringSends, svs.configstringSendsCoalesced,
+		total ? 100.0f * svs.configstringSendsCoalesced / total : 0.0f );
+}
+
+/*
+===============
+Configstring index
+
+Configstrings are chained by value in sv.configstringHash so the game can find
+the slot of a model, sound or effect name without copying out every string of
+its range. The game's lookup stops at the first empty slot of a range, which
+sv.configstringUsed finds a word at a time.
+===============
+*/
+static int SV_ConfigstringHash( const char *s ) {
+	unsigned int hash = 2166136261u;
+
+	while ( *s ) {
+		hash = ( hash ^ (byte)*s++ ) * 16777619u;
+	}
+
+	return (int)( hash & ( CONFIGSTRING_HASH_SIZE - 1 ) );
+}
+
+static void SV_UnlinkConfigstring( int index ) {
+	int *link;
+
+	if ( !( sv.configstringUsed[index >> 5] & ( 1u << ( index & 31 ) ) ) ) {
+		return;
+	}
+	sv.configstringUsed[index >> 5] &= ~( 1u << ( index & 31 ) );
+
+	for ( link = &sv.configstringHash[SV_ConfigstringHash( sv.configstrings[index] )]; *link; link = &sv.configstringNext[*link - 1] ) {
+		if ( *link - 1 == index ) {
+			*link = sv.configstringNext[index];
+			break;
+		}
+	}
+	sv.configstringNext[index] = 0;
+}
+
+static void SV_LinkConfigstring( int index ) {
+	int hash;
+
+	if ( !sv.configstrings[index][0] ) {
+		return;
+	}
+	sv.configstringUsed[index >> 5] |= 1u << ( index & 31 );
+
+	hash = SV_ConfigstringHash( sv.configstrings[index] );
+	sv.configstringNext[index] = sv.configstringHash[hash];
+	sv.configstringHash[hash] = index + 1;
+}
+
+// first empty configstring in from .. to - 1, to if there is none
+static int SV_FirstEmptyConfigstring( int from, int to ) {
+	int i = from;
+
+	while ( i < to ) {
+		uint32_t empty = ~sv.configstringUsed[i >> 5] >> ( i & 31 );
+
+		if ( empty ) {
+			while ( !( empty & 1 ) ) {
+				empty >>= 1;
+				i++;
+			}
+			break;
+		}
+		i = ( i | 31 ) + 1;
+	}
+
+	return Q_min( i, to );
+}
+
+/*
+===============
+SV_FindConfigstringIndex
+
+Returns the index of name relative to start, searching start + 1 up to the
+first empty configstring of the range like the game's linear search does.
+If it isn't there and create is set, name is put in that empty slot.
+===============
+*/
+int SV_FindConfigstringIndex( const char *name, int start, int max, qboolean create ) {
+	int i, found, empty;
+
+	if ( !name || !name[0] ) {
+		return 0;
+	}
+	if ( start < 0 || max < 1 || start + max > MAX_CONFIGSTRINGS ) {
+		Com_Error( ERR_DROP, "SV_FindConfigstringIndex: bad range %i, %i\n", start, max );
+	}
+
+	empty = SV_FirstEmptyConfigstring( start + 1, start + max );
+
+	found = 0;
+	for ( i = sv.configstringHash[SV_ConfigstringHash( name )]; i; i = sv.configstringNext[i - 1] ) {
+		if ( i - 1 > start && i - 1 < empty && ( !found || i - 1 < found ) && !strcmp( sv.configstrings[i - 1], name ) ) {
+			found = i - 1;
+		}
+	}
+	if ( found ) {
+		return found - start;
+	}
+
+	if ( !create ) {
+		return 0;
+	}
+
+	if ( empty == start + max ) {
+		Com_Error( ERR_DROP, "G_FindConfigstringIndex: overflow" );
+	}
+
+	SV_SetConfigstring( empty, name );
+
+	return empty - start;
+}
+
 /*
 ===============
 SV_SetConfigstring
@@ -127,14 +310,23 @@ void SV_SetConfigstring (int index, const char *val) {
 	}
 
 	// change the string in sv
+	SV_UnlinkConfigstring( index );
 	Z_Free( sv.configstrings[index] );
 	sv.configstrings[index] = CopyString( val );
+	SV_LinkConfigstring( index );
+
+	if ( index == CS_SERVERINFO ) {
+		svs.serverInfoModCount++;
+	}
+
+	SV_MultiViewDemoConfigstring( index );
 
 	// send it to all the clients if we aren't
 	// spawning a new server
 	if ( sv.state == SS_GAME || sv.restarting ) {
 
-		// send the data to all relevent clients
+		// mark the data for all relevent clients, it goes out once with the
+		// final value at the end of the frame
 		for (i = 0, client = svs.clients; i < sv_maxclients->integer ; i++, client++) {
 			if ( client->state < CS_ACTIVE ) {
 				if ( client->state == CS_PRIMED )
@@ -146,7 +338,16 @@ void SV_SetConfigstring (int index, const char *val) {
 				continue;
 			}
 
-			SV_SendConfigstring(client, index);
+			if ( client->csUpdated[ index ] ) {
+				svs.configstringSendsCoalesced++;
+			}
+			client->csUpdated[ index ] = qtrue;
+			client->csPending = qtrue;
+		}
+
+		if ( !sv.configstringChanged[ index ] ) {
+			sv.configstringChanged[ index ] = qtrue;
+			sv.changedConfigstrings[ sv.numChangedConfigstrings++ ] = index;
 		}
 	}
 }
@@ -1011,6 +1212,11 @@ void SV_Init (void) {
 	sv_autoDemo = Cvar_Get( "sv_autoDemo", "0", CVAR_ARCHIVE_ND | CVAR_SERVERINFO, "Automatically take server-side demos" );
 	sv_autoDemoBots = Cvar_Get( "sv_autoDemoBots", "0", CVAR_ARCHIVE_ND, "Record server-side demos for bots" );
 	sv_autoDemoMaxMaps = Cvar_Get( "sv_autoDemoMaxMaps", "0", CVAR_ARCHIVE_ND );
+	sv_autoDemoMultiView = Cvar_Get( "sv_autoDemoMultiView", "0", CVAR_ARCHIVE_ND, "Record all clients of a map into one server-side demo instead of one demo per client" );
+	sv_demoCompress = Cvar_Get( "sv_demoCompress", "0", CVAR_ARCHIVE_ND, "Gzip server-side demos while recording, with a seek index next to each demo" );
+	sv_rateLimitBuckets = Cvar_Get( "sv_rateLimitBuckets", "16384", CVAR_ARCHIVE_ND, "Number of addresses the connectionless request rate limiter can track" );
+	sv_rateLimitSubnet = Cvar_Get( "sv_rateLimitSubnet", "32", CVAR_ARCHIVE_ND, "Prefix length that addresses are grouped by for rate limiting, 24 limits whole /24 networks" );
+	sv_downloadCacheSize = Cvar_Get( "sv_downloadCacheSize", "16384", CVAR_ARCHIVE_ND, "KB of download file chunks kept in memory after clients are done with them" );
 
 	sv_legacyFixes = Cvar_Get( "sv_legacyFixes", "1", CVAR_ARCHIVE );
 
@@ -1018,6 +1224,10 @@ void SV_Init (void) {
 
 	// alpha - base_enhanced start
 	sv_printFullConnect = Cvar_Get( "sv_printFullConnect", "1", CVAR_ARCHIVE );
+	sv_dbWAL = Cvar_Get( "sv_dbWAL", "1", CVAR_ARCHIVE, "Use write-ahead logging for the server database" );
+	sv_dbSynchronous = Cvar_Get( "sv_dbSynchronous", "1", CVAR_ARCHIVE, "SQLite synchronous level for the server database (0: off, 1: normal, 2: full, 3: extra)" );
+	sv_dbBatchWindow = Cvar_Get( "sv_dbBatchWindow", "0", CVAR_ARCHIVE, "Milliseconds to gather asynchronous database writes into one transaction, 0 batches per frame" );
+	sv_dbPersistData = Cvar_Get( "sv_dbPersistData", "0", CVAR_ARCHIVE, "Keep the game data store in the server database across restarts" );
 
 	// initialize bot cvars so they are listed and can be set before loading the botlib
 	SV_BotInitCvars();
@@ -1092,6 +1302,9 @@ void SV_Shutdown( char *finalmsg )
 		SV_FinalMessage( finalmsg );
 	}
 
+	SV_StopMultiViewDemo();
+	SV_StopDemoTasks();
+
 	SV_RemoveOperatorCommands();
 	SV_MasterShutdown();
 	SV_ChallengeShutdown();
@@ -1112,6 +1325,7 @@ Ghoul2 Insert Start
 	CM_ClearMap();//jfm: add a clear here since it's commented out in clearServer.  This prevents crashing cmShaderTable on exit.
 
 	// free server static data
+	SV_ShutdownDownloads();
 	if ( svs.clients ) {
 		Z_Free( svs.clients );
 	}
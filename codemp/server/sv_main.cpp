@@ -68,13 +68,23 @@ cvar_t	*sv_filterCommands; // strict filtering on commands (1: strip ['\r', '\n'
 cvar_t	*sv_autoDemo;
 cvar_t	*sv_autoDemoBots;
 cvar_t	*sv_autoDemoMaxMaps;
+cvar_t	*sv_autoDemoMultiView;
+cvar_t	*sv_demoCompress;
+cvar_t	*sv_rateLimitBuckets;
+cvar_t	*sv_rateLimitSubnet;
+cvar_t	*sv_downloadCacheSize;
 cvar_t	*sv_legacyFixes;
 cvar_t	*sv_banFile;
 // alpha - base_enhanced start
 cvar_t	*sv_printFullConnect;
+cvar_t	*sv_dbWAL;
+cvar_t	*sv_dbSynchronous;
+cvar_t	*sv_dbBatchWindow;
+cvar_t	*sv_dbPersistData;
 
-serverBan_t serverBans[SERVER_MAXBANS];
+serverBan_t *serverBans;
 int serverBansCount = 0;
+ipTrie_t serverBanTrie = { NULL, 0, 0, -1, 0 };
 
 /*
 =============================================================================
@@ -126,6 +136,11 @@ void SV_AddServerCommand( client_t *client, const char *cmd ) {
 		return;
 	}
 
+	// keep configstrings set earlier in the frame ahead of this command
+	if ( client->csPending ) {
+		SV_SendChangedConfigstrings( client );
+	}
+
 	client->reliableSequence++;
 	// if we would be losing an old command that hasn't been acknowledged,
 	// we must drop the connection
@@ -172,6 +187,8 @@ void QDECL SV_SendServerCommand(client_t *cl, const char *fmt, ...) {
 		return;
 	}
 
+	SV_MultiViewDemoCommand( cl, (char *)message );
+
 	if ( cl != NULL ) {
 		SV_AddServerCommand( cl, (char *)message );
 		return;
@@ -312,113 +329,259 @@ CONNECTIONLESS COMMANDS
 ==============================================================================
 */
 
-// This is deliberately quite large to make it more of an effort to DoS
-#define MAX_BUCKETS			16384
-#define MAX_HASHES			1024
-
-static leakyBucket_t buckets[ MAX_BUCKETS ];
-static leakyBucket_t *bucketHashes[ MAX_HASHES ];
+// The per address buckets live in an open addressing table sized by sv_rateLimitBuckets,
+// which should be deliberately quite large to make it more of an effort to DoS.
+// Buckets are expired through a timing wheel of one second slots, so a flood from many
+// addresses costs a probe per packet instead of a scan over every bucket.
+#define RATELIMIT_WHEEL_SLOTS	64
+#define RATELIMIT_MIN_BUCKETS	1024
+
+typedef enum {
+	RLB_EMPTY,
+	RLB_USED,
+	RLB_DELETED
+} rateLimitBucketState_t;
+
+typedef struct rateLimitBucket_s {
+	leakyBucket_t	bucket;
+	uint32_t		key;				// address masked to sv_rateLimitSubnet
+	int				state;
+	int				expireTime;
+	int				wheelPrev, wheelNext;
+} rateLimitBucket_t;
+
+typedef struct rateLimitTable_s {
+	rateLimitBucket_t	*buckets;
+	int					size;			// power of two
+	int					used;
+	int					deleted;
+	uint32_t			seed;
+	int					wheel[RATELIMIT_WHEEL_SLOTS];
+	int					wheelTime;		// last second the wheel was advanced to
+	int					full;			// requests refused because the table was full
+	int					allowed[RATELIMIT_MAX];
+	int					dropped[RATELIMIT_MAX];
+} rateLimitTable_t;
+
+static rateLimitTable_t rateLimit;
 leakyBucket_t outboundLeakyBucket;
 
+static const char *rateLimitCategoryNames[RATELIMIT_MAX] = { "status", "info", "connect", "rcon" };
+
+/*
+================
+SVC_RateLimitSlot
+================
+*/
+static int SVC_RateLimitSlot( uint32_t key ) {
+	uint32_t hash = ( key ^ rateLimit.seed ) * 0x9E3779B1u;
+
+	hash ^= hash >> 15;
+	return (int)( hash & ( rateLimit.size - 1 ) );
+}
+
 /*
 ================
-SVC_HashForAddress
+SVC_RateLimitUnlink
 ================
 */
-static long SVC_HashForAddress( netadr_t address ) {
-	byte 		*ip = NULL;
-	size_t	size = 0;
-	long		hash = 0;
+static void SVC_RateLimitUnlink( int index ) {
+	rateLimitBucket_t *b = &rateLimit.buckets[index];
 
-	switch ( address.type ) {
-		case NA_IP:  ip = address.ip;  size = 4; break;
-		default: break;
+	if ( b->wheelPrev >= 0 ) {
+		rateLimit.buckets[b->wheelPrev].wheelNext = b->wheelNext;
+	} else {
+		rateLimit.wheel[( b->expireTime / 1000 ) & ( RATELIMIT_WHEEL_SLOTS - 1 )] = b->wheelNext;
 	}
 
-	for ( size_t i = 0; i < size; i++ ) {
-		hash += (long)( ip[ i ] ) * ( i + 119 );
+	if ( b->wheelNext >= 0 ) {
+		rateLimit.buckets[b->wheelNext].wheelPrev = b->wheelPrev;
 	}
+}
+
+/*
+================
+SVC_RateLimitLink
 
-	hash = ( hash ^ ( hash >> 10 ) ^ ( hash >> 20 ) );
-	hash &= ( MAX_HASHES - 1 );
+Puts a bucket in the wheel slot of its expire time
+================
+*/
+static void SVC_RateLimitLink( int index, int expireTime ) {
+	rateLimitBucket_t *b = &rateLimit.buckets[index];
+	int slot = ( expireTime / 1000 ) & ( RATELIMIT_WHEEL_SLOTS - 1 );
 
-	return hash;
+	b->expireTime = expireTime;
+	b->wheelPrev = -1;
+	b->wheelNext = rateLimit.wheel[slot];
+	if ( b->wheelNext >= 0 ) {
+		rateLimit.buckets[b->wheelNext].wheelPrev = index;
+	}
+	rateLimit.wheel[slot] = index;
 }
 
 /*
 ================
-SVC_BucketForAddress
+SVC_RateLimitInsert
+================
+*/
+static int SVC_RateLimitInsert( uint32_t key ) {
+	int index = SVC_RateLimitSlot( key );
 
-Find or allocate a bucket for an address
+	while ( rateLimit.buckets[index].state == RLB_USED ) {
+		index = ( index + 1 ) & ( rateLimit.size - 1 );
+	}
+
+	if ( rateLimit.buckets[index].state == RLB_DELETED ) {
+		rateLimit.deleted--;
+	}
+
+	Com_Memset( &rateLimit.buckets[index], 0, sizeof( rateLimitBucket_t ) );
+	rateLimit.buckets[index].key = key;
+	rateLimit.buckets[index].state = RLB_USED;
+	rateLimit.used++;
+
+	return index;
+}
+
+/*
+================
+SVC_RateLimitResize
+
+Rebuilds the table at the given size, dropping tombstones and keeping
+as many live buckets as fit
 ================
 */
-static leakyBucket_t *SVC_BucketForAddress( netadr_t address, int burst, int period ) {
-	leakyBucket_t	*bucket = NULL;
-	int						i;
-	long					hash = SVC_HashForAddress( address );
-	int						now = Sys_Milliseconds();
-
-	for ( bucket = bucketHashes[ hash ]; bucket; bucket = bucket->next ) {
-		switch ( bucket->type ) {
-			case NA_IP:
-				if ( memcmp( bucket->ipv._4, address.ip, 4 ) == 0 ) {
-					return bucket;
-				}
-				break;
+static void SVC_RateLimitResize( int size ) {
+	rateLimitBucket_t	*old = rateLimit.buckets;
+	int					oldSize = rateLimit.size;
+	int					i;
+
+	rateLimit.buckets = (rateLimitBucket_t *)Z_Malloc( size * sizeof( rateLimitBucket_t ), TAG_CLIENTS, qtrue );
+	rateLimit.size = size;
+	rateLimit.used = rateLimit.deleted = 0;
+	for ( i = 0; i < RATELIMIT_WHEEL_SLOTS; i++ ) {
+		rateLimit.wheel[i] = -1;
+	}
+
+	if ( !rateLimit.seed ) {
+		rateLimit.seed = ( ( (uint32_t)Com_Milliseconds() * 2654435761u ) ^ (uint32_t)time( NULL ) ) | 1;
+	}
+
+	for ( i = 0; i < oldSize; i++ ) {
+		if ( old[i].state == RLB_USED && rateLimit.used < size / 2 ) {
+			int index = SVC_RateLimitInsert( old[i].key );
 
-			default:
-				break;
+			rateLimit.buckets[index].bucket = old[i].bucket;
+			SVC_RateLimitLink( index, old[i].expireTime );
 		}
 	}
 
-	for ( i = 0; i < MAX_BUCKETS; i++ ) {
-		int interval;
+	if ( old ) {
+		Z_Free( old );
+	}
+}
 
-		bucket = &buckets[ i ];
-		interval = now - bucket->lastTime;
+/*
+================
+SVC_RateLimitExpire
 
-		// Reclaim expired buckets
-		if ( bucket->lastTime > 0 && ( interval > ( burst * period ) ||
-					interval < 0 ) ) {
-			if ( bucket->prev != NULL ) {
-				bucket->prev->next = bucket->next;
-			} else {
-				bucketHashes[ bucket->hash ] = bucket->next;
-			}
+Advances the timing wheel to now and frees the buckets that have drained
+================
+*/
+static void SVC_RateLimitExpire( int now ) {
+	// a slot is only visited once its second is over, so everything in it
+	// that isn't a lap ahead has expired by then
+	int second = now / 1000 - 1;
+	int steps = second - rateLimit.wheelTime;
 
-			if ( bucket->next != NULL ) {
-				bucket->next->prev = bucket->prev;
-			}
+	if ( steps <= 0 ) {
+		return;
+	}
 
-			Com_Memset( bucket, 0, sizeof( leakyBucket_t ) );
-		}
+	if ( steps > RATELIMIT_WHEEL_SLOTS ) {
+		steps = RATELIMIT_WHEEL_SLOTS;
+	}
 
-		if ( bucket->type == NA_BAD ) {
-			bucket->type = address.type;
-			switch ( address.type ) {
-				case NA_IP:  Com_Memcpy( bucket->ipv._4, address.ip, 4 );   break;
-				default: break;
-			}
+	for ( ; steps > 0; steps-- ) {
+		int slot = ( second - steps + 1 ) & ( RATELIMIT_WHEEL_SLOTS - 1 );
+		int index = rateLimit.wheel[slot];
 
-			bucket->lastTime = now;
-			bucket->burst = 0;
-			bucket->hash = hash;
+		while ( index >= 0 ) {
+			rateLimitBucket_t *b = &rateLimit.buckets[index];
+			int next = b->wheelNext;
 
-			// Add to the head of the relevant hash chain
-			bucket->next = bucketHashes[ hash ];
-			if ( bucketHashes[ hash ] != NULL ) {
-				bucketHashes[ hash ]->prev = bucket;
+			if ( b->expireTime <= now ) {
+				SVC_RateLimitUnlink( index );
+				b->state = RLB_DELETED;
+				rateLimit.used--;
+				rateLimit.deleted++;
 			}
+			index = next;
+		}
+	}
+
+	rateLimit.wheelTime = second;
+}
+
+/*
+================
+SVC_KeyForAddress
 
-			bucket->prev = NULL;
-			bucketHashes[ hash ] = bucket;
+Masks an address to the sv_rateLimitSubnet prefix
+================
+*/
+static uint32_t SVC_KeyForAddress( netadr_t address ) {
+	uint32_t key = ( (uint32_t)address.ip[0] << 24 ) | ( (uint32_t)address.ip[1] << 16 ) | ( (uint32_t)address.ip[2] << 8 ) | address.ip[3];
+	int prefix = sv_rateLimitSubnet->integer;
 
-			return bucket;
+	if ( prefix > 0 && prefix < 32 ) {
+		key &= ~( 0xFFFFFFFFu >> prefix );
+	}
+
+	return key;
+}
+
+/*
+================
+SVC_BucketForAddress
+
+Find or allocate a bucket for an address
+================
+*/
+static rateLimitBucket_t *SVC_BucketForAddress( netadr_t address ) {
+	uint32_t	key = SVC_KeyForAddress( address );
+	int			size, index;
+
+	size = RATELIMIT_MIN_BUCKETS;
+	while ( size < sv_rateLimitBuckets->integer && size < ( 1 << 24 ) ) {
+		size <<= 1;
+	}
+	if ( size != rateLimit.size ) {
+		SVC_RateLimitResize( size );
+	}
+
+	SVC_RateLimitExpire( Sys_Milliseconds() );
+
+	for ( index = SVC_RateLimitSlot( key ); rateLimit.buckets[index].state != RLB_EMPTY; index = ( index + 1 ) & ( rateLimit.size - 1 ) ) {
+		if ( rateLimit.buckets[index].state == RLB_USED && rateLimit.buckets[index].key == key ) {
+			return &rateLimit.buckets[index];
 		}
 	}
 
-	// Couldn't allocate a bucket for this address
-	return NULL;
+	// keep the probe sequences short, tombstones count against the load too
+	if ( rateLimit.used + rateLimit.deleted >= rateLimit.size * 3 / 4 ) {
+		if ( rateLimit.used >= rateLimit.size / 2 ) {
+			// Couldn't allocate a bucket for this address
+			rateLimit.full++;
+			return NULL;
+		}
+		SVC_RateLimitResize( rateLimit.size );
+	}
+
+	index = SVC_RateLimitInsert( key );
+	SVC_RateLimitLink( index, Sys_Milliseconds() );
+
+	return &rateLimit.buckets[index];
 }
 
 /*
@@ -458,10 +621,156 @@ SVC_RateLimitAddress
 Rate limit for a particular address
 ================
 */
-qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period ) {
-	leakyBucket_t *bucket = SVC_BucketForAddress( from, burst, period );
+qboolean SVC_RateLimitAddress( netadr_t from, int burst, int period, rateLimitCategory_t category ) {
+	rateLimitBucket_t	*b;
+	qboolean			limited;
+
+	// only real addresses are limited, the others don't come from the network
+	if ( from.type != NA_IP ) {
+		rateLimit.allowed[category]++;
+		return qfalse;
+	}
+
+	b = SVC_BucketForAddress( from );
+	if ( b ) {
+		limited = SVC_RateLimit( &b->bucket, burst, period );
 
-	return SVC_RateLimit( bucket, burst, period );
+		// drained once enough periods have passed to empty a full bucket
+		SVC_RateLimitUnlink( b - rateLimit.buckets );
+		SVC_RateLimitLink( b - rateLimit.buckets, b->bucket.lastTime + burst * period );
+	} else {
+		limited = qtrue;
+	}
+
+	if ( limited ) {
+		rateLimit.dropped[category]++;
+	} else {
+		rateLimit.allowed[category]++;
+	}
+
+	return limited;
+}
+
+/*
+================
+SV_RateLimitInfo_f
+================
+*/
+void SV_RateLimitInfo_f( void ) {
+	int i;
+
+	Com_Printf( "Rate limit buckets: %d in use of %d, %d tombstones, %d requests refused for lack of buckets\n",
+		rateLimit.used, rateLimit.size, rateLimit.deleted, rateLimit.full );
+	if ( sv_rateLimitSubnet->integer > 0 && sv_rateLimitSubnet->integer < 32 ) {
+		Com_Printf( "Addresses are grouped by /%d\n", sv_rateLimitSubnet->integer );
+	}
+
+	Com_Printf( "%-10s %10s %10s\n", "request", "allowed", "dropped" );
+	for ( i = 0; i < RATELIMIT_MAX; i++ ) {
+		Com_Printf( "%-10s %10d %10d\n", rateLimitCategoryNames[i], rateLimit.allowed[i], rateLimit.dropped[i] );
+	}
+}
+
+/*
+================
+SVC_SendCachedResponse
+
+Sends a pre-built getstatus/getinfo reply with the challenge of the request
+spliced in front of the infostring, where Info_SetValueForKey would have put it
+================
+*/
+static void SVC_SendCachedResponse( netadr_t from, const char *header, const svResponseCache_t *cache ) {
+	char		packet[MAX_MSGLEN];
+	const char	*challenge = Cmd_Argv( 1 );
+	int			length, challengeLength, bodyLength;
+
+	packet[0] = packet[1] = packet[2] = packet[3] = -1;
+	length = 4 + Com_sprintf( packet + 4, sizeof( packet ) - 4, "%s", header );
+
+	// echo back the parameter to status. so master servers can use it as a challenge
+	// to prevent timed spoofed reply packets that add ghost servers
+	challengeLength = strlen( challenge );
+	if ( challengeLength && !strpbrk( challenge, "\\;\"" )
+		&& cache->infoLength + challengeLength + 11 < MAX_INFO_STRING ) {
+		length += Com_sprintf( packet + length, sizeof( packet ) - length, "\\challenge\\%s", challenge );
+	}
+
+	bodyLength = Q_min( cache->bodyLength, (int)sizeof( packet ) - 1 - length );
+	memcpy( packet + length, cache->body, bodyLength );
+	length += bodyLength;
+
+	NET_SendPacket( NS_SERVER, length, packet, from );
+}
+
+/*
+================
+SVC_UpdateStatusCache
+
+Rebuilds the getstatus reply if the serverinfo or any player's name, score or ping changed
+================
+*/
+static void SVC_UpdateStatusCache( void ) {
+	svResponseCache_t	*cache = &svs.statusCache;
+	svStatusPlayer_t	*player;
+	char		infostring[MAX_INFO_STRING];
+	char		line[1024];
+	int			i, lineLength;
+	client_t	*cl;
+	playerState_t	*ps;
+	qboolean	changed;
+
+	// serverinfo cvars that changed this frame haven't reached the configstring yet
+	changed = (qboolean)( !cache->valid || cache->serverInfoModCount != svs.serverInfoModCount
+		|| ( cvar_modifiedFlags & CVAR_SERVERINFO ) );
+
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		cl = &svs.clients[i];
+		player = &svs.statusPlayers[i];
+
+		if ( cl->state < CS_CONNECTED ) {
+			if ( player->connected ) {
+				player->connected = qfalse;
+				changed = qtrue;
+			}
+			continue;
+		}
+
+		ps = SV_GameClientNum( i );
+		if ( !player->connected || player->score != ps->persistant[PERS_SCORE]
+			|| player->ping != cl->ping || strcmp( player->name, cl->name ) ) {
+			player->connected = qtrue;
+			player->score = ps->persistant[PERS_SCORE];
+			player->ping = cl->ping;
+			Q_strncpyz( player->name, cl->name, sizeof( player->name ) );
+			changed = qtrue;
+		}
+	}
+
+	if ( !changed ) {
+		return;
+	}
+
+	Q_strncpyz( infostring, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( infostring ) );
+	Info_RemoveKey( infostring, "challenge" );
+
+	cache->infoLength = strlen( infostring );
+	cache->bodyLength = Com_sprintf( cache->body, sizeof( cache->body ), "%s\n", infostring );
+
+	for ( i = 0 ; i < sv_maxclients->integer ; i++ ) {
+		player = &svs.statusPlayers[i];
+		if ( player->connected ) {
+			Com_sprintf( line, sizeof( line ), "%i %i \"%s\"\n", player->score, player->ping, player->name );
+			lineLength = strlen( line );
+			if ( cache->bodyLength + lineLength >= (int)sizeof( cache->body ) ) {
+				break;		// can't hold any more
+			}
+			strcpy( cache->body + cache->bodyLength, line );
+			cache->bodyLength += lineLength;
+		}
+	}
+
+	cache->serverInfoModCount = svs.serverInfoModCount;
+	cache->valid = qtrue;
 }
 
 /*
@@ -474,15 +783,6 @@ the simple info query.
 ================
 */
 void SVC_Status( netadr_t from ) {
-	char	player[1024];
-	char	status[MAX_MSGLEN];
-	int		i;
-	client_t	*cl;
-	playerState_t	*ps;
-	int		statusLength;
-	int		playerLength;
-	char	infostring[MAX_INFO_STRING];
-
 	// ignore if we are in single player
 	/*
 	if ( Cvar_VariableValue( "g_gametype" ) == GT_SINGLE_PLAYER ) {
@@ -491,7 +791,7 @@ void SVC_Status( netadr_t from ) {
 	*/
 
 	// Prevent using getstatus as an amplifier
-	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
+	if ( SVC_RateLimitAddress( from, 10, 1000, RATELIMIT_STATUS ) ) {
 		if ( com_developer->integer ) {
 			Com_Printf( "SVC_Status: rate limit from %s exceeded, dropping request\n",
 				NET_AdrToString( from ) );
@@ -510,31 +810,71 @@ void SVC_Status( netadr_t from ) {
 	if(strlen(Cmd_Argv(1)) > 128)
 		return;
 
-	Q_strncpyz( infostring, Cvar_InfoString( CVAR_SERVERINFO ), sizeof( infostring ) );
+	SVC_UpdateStatusCache();
+	SVC_SendCachedResponse( from, "statusResponse\n", &svs.statusCache );
+}
 
-	// echo back the parameter to status. so master servers can use it as a challenge
-	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
+/*
+================
+SVC_UpdateInfoCache
 
-	status[0] = 0;
-	statusLength = 0;
+Rebuilds the getinfo reply if the serverinfo or the player counts changed
+================
+*/
+static void SVC_UpdateInfoCache( int count, int humans ) {
+	svResponseCache_t	*cache = &svs.infoCache;
+	char	*gamedir;
+	char	infostring[MAX_INFO_STRING];
+	int		wDisable;
 
-	for (i=0 ; i < sv_maxclients->integer ; i++) {
-		cl = &svs.clients[i];
-		if ( cl->state >= CS_CONNECTED ) {
-			ps = SV_GameClientNum( i );
-			Com_sprintf (player, sizeof(player), "%i %i \"%s\"\n",
-				ps->persistant[PERS_SCORE], cl->ping, cl->name);
-			playerLength = strlen(player);
-			if (statusLength + playerLength >= (int)sizeof(status) ) {
-				break;		// can't hold any more
-			}
-			strcpy (status + statusLength, player);
-			statusLength += playerLength;
-		}
+	// serverinfo cvars that changed this frame haven't reached the configstring yet
+	if ( cache->valid && cache->serverInfoModCount == svs.serverInfoModCount
+		&& !( cvar_modifiedFlags & CVAR_SERVERINFO )
+		&& cache->clients == count && cache->humans == humans ) {
+		return;
+	}
+
+	infostring[0] = 0;
+
+	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
+	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
+	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
+	Info_SetValueForKey( infostring, "clients", va("%i", count) );
+	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
+	Info_SetValueForKey( infostring, "sv_maxclients",
+		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
+	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
+	Info_SetValueForKey( infostring, "needpass", va("%i", sv_needpass->integer ) );
+	Info_SetValueForKey( infostring, "truejedi", va("%i", Cvar_VariableIntegerValue( "g_jediVmerc" ) ) );
+	if ( sv_gametype->integer == GT_DUEL || sv_gametype->integer == GT_POWERDUEL )
+	{
+		wDisable = Cvar_VariableIntegerValue( "g_duelWeaponDisable" );
+	}
+	else
+	{
+		wDisable = Cvar_VariableIntegerValue( "g_weaponDisable" );
+	}
+	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
+	Info_SetValueForKey( infostring, "fdisable", va("%i", Cvar_VariableIntegerValue( "g_forcePowerDisable" ) ) );
+	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
+	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
+
+	if( sv_minPing->integer ) {
+		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
+	}
+	if( sv_maxPing->integer ) {
+		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
+	}
+	gamedir = Cvar_VariableString( "fs_game" );
+	if( *gamedir ) {
+		Info_SetValueForKey( infostring, "game", gamedir );
 	}
 
-	NET_OutOfBandPrint( NS_SERVER, from, "statusResponse\n%s\n%s", infostring, status );
+	cache->infoLength = cache->bodyLength = Com_sprintf( cache->body, sizeof( cache->body ), "%s", infostring );
+	cache->clients = count;
+	cache->humans = humans;
+	cache->serverInfoModCount = svs.serverInfoModCount;
+	cache->valid = qtrue;
 }
 
 /*
@@ -546,9 +886,7 @@ if a user is interested in a server to do a full status
 ================
 */
 void SVC_Info( netadr_t from ) {
-	int		i, count, humans, wDisable;
-	char	*gamedir;
-	char	infostring[MAX_INFO_STRING];
+	int		i, count, humans;
 
 	// ignore if we are in single player
 	/*
@@ -563,7 +901,7 @@ void SVC_Info( netadr_t from ) {
 	}
 
 	// Prevent using getinfo as an amplifier
-	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
+	if ( SVC_RateLimitAddress( from, 10, 1000, RATELIMIT_INFO ) ) {
 		if ( com_developer->integer ) {
 			Com_Printf( "SVC_Info: rate limit from %s exceeded, dropping request\n",
 				NET_AdrToString( from ) );
@@ -598,47 +936,8 @@ void SVC_Info( netadr_t from ) {
 		}
 	}
 
-	infostring[0] = 0;
-
-	// echo back the parameter to status. so servers can use it as a challenge
-	// to prevent timed spoofed reply packets that add ghost servers
-	Info_SetValueForKey( infostring, "challenge", Cmd_Argv(1) );
-
-	Info_SetValueForKey( infostring, "protocol", va("%i", PROTOCOL_VERSION) );
-	Info_SetValueForKey( infostring, "hostname", sv_hostname->string );
-	Info_SetValueForKey( infostring, "mapname", sv_mapname->string );
-	Info_SetValueForKey( infostring, "clients", va("%i", count) );
-	Info_SetValueForKey( infostring, "g_humanplayers", va("%i", humans) );
-	Info_SetValueForKey( infostring, "sv_maxclients",
-		va("%i", sv_maxclients->integer - sv_privateClients->integer ) );
-	Info_SetValueForKey( infostring, "gametype", va("%i", sv_gametype->integer ) );
-	Info_SetValueForKey( infostring, "needpass", va("%i", sv_needpass->integer ) );
-	Info_SetValueForKey( infostring, "truejedi", va("%i", Cvar_VariableIntegerValue( "g_jediVmerc" ) ) );
-	if ( sv_gametype->integer == GT_DUEL || sv_gametype->integer == GT_POWERDUEL )
-	{
-		wDisable = Cvar_VariableIntegerValue( "g_duelWeaponDisable" );
-	}
-	else
-	{
-		wDisable = Cvar_VariableIntegerValue( "g_weaponDisable" );
-	}
-	Info_SetValueForKey( infostring, "wdisable", va("%i", wDisable ) );
-	Info_SetValueForKey( infostring, "fdisable", va("%i", Cvar_VariableIntegerValue( "g_forcePowerDisable" ) ) );
-	//Info_SetValueForKey( infostring, "pure", va("%i", sv_pure->integer ) );
-	Info_SetValueForKey( infostring, "autodemo", va("%i", sv_autoDemo->integer ) );
-
-	if( sv_minPing->integer ) {
-		Info_SetValueForKey( infostring, "minPing", va("%i", sv_minPing->integer) );
-	}
-	if( sv_maxPing->integer ) {
-		Info_SetValueForKey( infostring, "maxPing", va("%i", sv_maxPing->integer) );
-	}
-	gamedir = Cvar_VariableString( "fs_game" );
-	if( *gamedir ) {
-		Info_SetValueForKey( infostring, "game", gamedir );
-	}
-
-	NET_OutOfBandPrint( NS_SERVER, from, "infoResponse\n%s", infostring );
+	SVC_UpdateInfoCache( count, humans );
+	SVC_SendCachedResponse( from, "infoResponse\n", &svs.infoCache );
 }
 
 /*
@@ -670,7 +969,7 @@ void SVC_RemoteCommand( netadr_t from, msg_t *msg ) {
 	char		*cmd_aux;
 
 	// Prevent using rcon as an amplifier and make dictionary attacks impractical
-	if ( SVC_RateLimitAddress( from, 10, 1000 ) ) {
+	if ( SVC_RateLimitAddress( from, 10, 1000, RATELIMIT_RCON ) ) {
 		if ( com_developer->integer ) {
 			Com_Printf( "SVC_RemoteCommand: rate limit from %s exceeded, dropping request\n",
 				NET_AdrToString( from ) );
@@ -1237,6 +1536,9 @@ void SV_Frame( int msec ) {
 
 	if (com_dedicated->integer) SV_BotFrame( sv.time );
 
+	// hand the results of finished database queries to the game
+	SV_RunDBCallbacks();
+
 	// run the game simulation in chunks
 	while ( sv.timeResidual >= frameMsec ) {
 		sv.timeResidual -= frameMsec;
@@ -1247,6 +1549,12 @@ void SV_Frame( int msec ) {
 		GVM_RunFrame( sv.time );
 	}
 
+	// send the configstrings changed since the last frame once, with their final values
+	SV_FlushConfigstrings();
+
+	// queue the database writes of this frame as one transaction
+	SV_FlushDBBatch( qfalse );
+
 	//rww - RAGDOLL_BEGIN
 	re->G2API_SetTime(sv.time,0);
 	//rww - RAGDOLL_END
@@ -1258,6 +1566,9 @@ void SV_Frame( int msec ) {
 	// check timeouts
 	SV_CheckTimeouts();
 
+	// record the world once for everyone
+	SV_MultiViewDemoFrame();
+
 	// send messages back to the clients
 	SV_SendClientMessages();
 
@@ -1265,6 +1576,9 @@ void SV_Frame( int msec ) {
 
 	// send a heartbeat to the master if needed
 	SV_MasterHeartbeat();
+
+	// release this frame's scratch memory
+	Frame_Reset();
 }
 
 /*
@@ -0,0 +1,449 @@
+#include "server.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+=============================================================================
+
+Multi-view server demos
+
+Instead of one file per client holding that client's snapshots, the whole
+world is written once per server frame: every active client's playerstate,
+every entity that could be sent to anyone, and the server commands of the
+frame. A client's demo can be rebuilt from it offline by running the usual
+snapshot visibility checks against the map, so the entity visibility info
+the server uses is stored along with the entities.
+
+The file is a series of blocks:
+
+4	length of the block, -1 ends the file
+<block>	huffman coded message
+
+A gamestate block starts the file:
+
+1	mvd_gamestate
+4	MVD_VERSION
+4	sv_maxclients
+4	checksumFeed
+<configstrings>	short index, bigstring, terminated by MAX_CONFIGSTRINGS
+<baselines>		delta entities from the null state, terminated by MAX_GENTITIES-1
+
+Followed by a frame block every server frame that has active clients:
+
+1	mvd_frame
+4	serverTime
+1	keyframe, 1 if nothing in this frame is delta coded against older frames
+<commands>		byte target client (MVD_BROADCAST for everyone), string, terminated by MVD_END
+<configstrings>	changed (or on keyframes all) configstrings, as in the gamestate
+4	bitmask of the clients in the frame
+<playerstates>	for every client in the mask: playerstate, byte vehicle, vehicle playerstate
+<entities>		delta entities as in a snapshot
+<visibility>	changed visibility info, GENTITYNUM_BITS number, svFlags, singleClient,
+				broadcastClients, areas and clusters, terminated by MAX_GENTITIES-1
+
+Playerstates are delta coded against the same client's playerstate of the
+previous frame if it was in that frame's mask, entities against the previous
+frame's entities or their baseline. Keyframes delta everything against
+nothing / the baseline and are written every MVD_KEYFRAME_MSEC. With
+sv_demoCompress they are the seek points of the index.
+
+=============================================================================
+*/
+
+#define MVD_VERSION			1
+#define MVD_KEYFRAME_MSEC	10000
+#define MVD_MSGLEN			( MAX_MSGLEN * 8 )
+
+#define MVD_BROADCAST		255
+#define MVD_END				254
+
+enum {
+	mvd_gamestate,
+	mvd_frame
+};
+
+// visibility info of an entity, see SV_AddEntitiesVisibleFromPoint
+typedef struct {
+	int			svFlags;
+	int			singleClient;
+	uint32_t	broadcastClients[2];
+	int			areanum, areanum2;
+	int			numClusters;
+	int			lastCluster;
+	int			clusternums[MAX_ENT_CLUSTERS];
+} mvdEntityVis_t;
+
+typedef struct {
+	qboolean		recording;
+	fileHandle_t	file;
+	char			name[MAX_OSPATH];
+
+	byte			*msgBuf;
+	int				lastFrameTime;
+	int				lastKeyframe;
+	qboolean		needKeyframe;
+
+	// what the last written frame holds, for delta compression
+	uint32_t		clientMask;
+	playerState_t	ps[MAX_CLIENTS];
+	playerState_t	vps[MAX_CLIENTS];
+	qboolean		hasVehicle[MAX_CLIENTS];
+	entityState_t	*entities;		// [MAX_GENTITIES]
+	mvdEntityVis_t	*vis;			// [MAX_GENTITIES]
+	byte			entityInFrame[MAX_GENTITIES];
+
+	// gathered until the next frame
+	std::vector<std::pair<int, std::string>>	commands;
+	qboolean		csChanged[MAX_CONFIGSTRINGS];
+
+	int				frames;
+	int				bytes;
+} mvDemo_t;
+
+static mvDemo_t mvDemo;
+
+static void SV_MVDemoWriteBlock( msg_t *msg ) {
+	int len = LittleLong( msg->cursize );
+
+	FS_Write( &len, 4, mvDemo.file );
+	FS_Write( msg->data, msg->cursize, mvDemo.file );
+	mvDemo.bytes += 4 + msg->cursize;
+}
+
+static void SV_MVDemoWriteConfigstring( msg_t *msg, int index ) {
+	MSG_WriteShort( msg, index );
+	MSG_WriteBigString( msg, sv.configstrings[index] );
+}
+
+static void SV_MVDemoWriteGamestate( void ) {
+	msg_t			msg;
+	entityState_t	nullstate;
+	int				i;
+
+	MSG_Init( &msg, mvDemo.msgBuf, MVD_MSGLEN );
+
+	MSG_WriteByte( &msg, mvd_gamestate );
+	MSG_WriteLong( &msg, MVD_VERSION );
+	MSG_WriteLong( &msg, sv_maxclients->integer );
+	MSG_WriteLong( &msg, sv.checksumFeed );
+
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( sv.configstrings[i][0] ) {
+			SV_MVDemoWriteConfigstring( &msg, i );
+		}
+	}
+	MSG_WriteShort( &msg, MAX_CONFIGSTRINGS );
+
+	Com_Memset( &nullstate, 0, sizeof( nullstate ) );
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		entityState_t *base = &sv.svEntities[i].baseline;
+		if ( !base->number ) {
+			continue;
+		}
+		MSG_WriteDeltaEntity( &msg, &nullstate, base, qtrue );
+	}
+	MSG_WriteBits( &msg, ( MAX_GENTITIES - 1 ), GENTITYNUM_BITS );
+
+	SV_MVDemoWriteBlock( &msg );
+}
+
+static void SV_MVDemoWritePlayerstate( msg_t *msg, playerState_t *from, playerState_t *to, qboolean isVehiclePS ) {
+#ifdef _ONEBIT_COMBO
+	MSG_WriteDeltaPlayerstate( msg, from, to, NULL, NULL, isVehiclePS );
+#else
+	MSG_WriteDeltaPlayerstate( msg, from, to, isVehiclePS );
+#endif
+}
+
+// the entities that could be in anyone's snapshot, the same checks as
+// SV_AddEntitiesVisibleFromPoint does before looking at the viewer
+static qboolean SV_MVDemoEntityInFrame( sharedEntity_t *ent ) {
+	if ( !ent->r.linked ) {
+		return qfalse;
+	}
+	if ( ent->s.eFlags & EF_PERMANENT ) {
+		return qfalse;
+	}
+	if ( ent->r.svFlags & SVF_NOCLIENT ) {
+		return qfalse;
+	}
+	return qtrue;
+}
+
+static void SV_MVDemoGetVis( int num, sharedEntity_t *ent, mvdEntityVis_t *vis ) {
+	svEntity_t *svEnt = &sv.svEntities[num];
+
+	Com_Memset( vis, 0, sizeof( *vis ) );
+	vis->svFlags = ent->r.svFlags;
+	vis->singleClient = ent->r.singleClient;
+	vis->broadcastClients[0] = ent->r.broadcastClients[0];
+	vis->broadcastClients[1] = ent->r.broadcastClients[1];
+	vis->areanum = svEnt->areanum;
+	vis->areanum2 = svEnt->areanum2;
+	vis->numClusters = svEnt->numClusters;
+	vis->lastCluster = svEnt->lastCluster;
+	for ( int i = 0; i < svEnt->numClusters && i < MAX_ENT_CLUSTERS; i++ ) {
+		vis->clusternums[i] = svEnt->clusternums[i];
+	}
+}
+
+static void SV_MVDemoWriteFrame( void ) {
+	msg_t			msg;
+	qboolean		keyframe;
+	uint32_t		clientMask = 0;
+	int				i;
+
+	for ( i = 0; i < sv_maxclients->integer; i++ ) {
+		client_t *cl = &svs.clients[i];
+		if ( cl->state == CS_ACTIVE && cl->gentity ) {
+			clientMask |= 1u << i;
+		}
+	}
+
+	if ( !clientMask ) {
+		// nobody to watch, pick up with a keyframe once someone shows up
+		mvDemo.commands.clear();
+		mvDemo.needKeyframe = qtrue;
+		return;
+	}
+
+	keyframe = (qboolean)( mvDemo.needKeyframe || sv.time - mvDemo.lastKeyframe >= MVD_KEYFRAME_MSEC
+		|| sv.time < mvDemo.lastKeyframe );
+	if ( keyframe ) {
+		mvDemo.lastKeyframe = sv.time;
+		mvDemo.needKeyframe = qfalse;
+		mvDemo.clientMask = 0;
+		Com_Memset( mvDemo.entityInFrame, 0, sizeof( mvDemo.entityInFrame ) );
+	}
+
+	MSG_Init( &msg, mvDemo.msgBuf, MVD_MSGLEN );
+	msg.allowoverflow = qtrue;
+
+	MSG_WriteByte( &msg, mvd_frame );
+	MSG_WriteLong( &msg, sv.time );
+	MSG_WriteByte( &msg, keyframe );
+
+	// server commands
+	for ( const auto &cmd : mvDemo.commands ) {
+		MSG_WriteByte( &msg, cmd.first );
+		MSG_WriteString( &msg, cmd.second.c_str() );
+	}
+	MSG_WriteByte( &msg, MVD_END );
+	mvDemo.commands.clear();
+
+	// configstrings
+	for ( i = 0; i < MAX_CONFIGSTRINGS; i++ ) {
+		if ( mvDemo.csChanged[i] || ( keyframe && sv.configstrings[i][0] ) ) {
+			SV_MVDemoWriteConfigstring( &msg, i );
+		}
+	}
+	MSG_WriteShort( &msg, MAX_CONFIGSTRINGS );
+	Com_Memset( mvDemo.csChanged, 0, sizeof( mvDemo.csChanged ) );
+
+	// playerstates
+	MSG_WriteLong( &msg, (int)clientMask );
+	for ( i = 0; i < sv_maxclients->integer; i++ ) {
+		if ( !( clientMask & ( 1u << i ) ) ) {
+			continue;
+		}
+
+		playerState_t *ps = SV_GameClientNum( i );
+		qboolean inLastFrame = (qboolean)( ( mvDemo.clientMask & ( 1u << i ) ) != 0 );
+
+		SV_MVDemoWritePlayerstate( &msg, inLastFrame ? &mvDemo.ps[i] : NULL, ps, qfalse );
+		mvDemo.ps[i] = *ps;
+
+		sharedEntity_t *veh = ps->m_iVehicleNum ? SV_GentityNum( ps->m_iVehicleNum ) : NULL;
+		if ( veh && veh->playerState ) {
+			playerState_t *vps = (playerState_t *)VM_ArgPtr( (intptr_t)veh->playerState );
+
+			MSG_WriteByte( &msg, 1 );
+			SV_MVDemoWritePlayerstate( &msg, ( inLastFrame && mvDemo.hasVehicle[i] ) ? &mvDemo.vps[i] : NULL, vps, qtrue );
+			mvDemo.vps[i] = *vps;
+			mvDemo.hasVehicle[i] = qtrue;
+		} else {
+			MSG_WriteByte( &msg, 0 );
+			mvDemo.hasVehicle[i] = qfalse;
+		}
+	}
+	mvDemo.clientMask = clientMask;
+
+	// entities, delta coded the same way as SV_EmitPacketEntities does
+	int numEntities = sv.num_entities;
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		sharedEntity_t *ent = i < numEntities ? SV_GentityNum( i ) : NULL;
+		qboolean inFrame = (qboolean)( ent && SV_MVDemoEntityInFrame( ent ) );
+
+		if ( inFrame && ent->s.number != i ) {
+			ent->s.number = i;
+		}
+
+		if ( inFrame && mvDemo.entityInFrame[i] ) {
+			MSG_WriteDeltaEntity( &msg, &mvDemo.entities[i], &ent->s, qfalse );
+		} else if ( inFrame ) {
+			MSG_WriteDeltaEntity( &msg, &sv.svEntities[i].baseline, &ent->s, qtrue );
+		} else if ( mvDemo.entityInFrame[i] ) {
+			MSG_WriteDeltaEntity( &msg, &mvDemo.entities[i], NULL, qtrue );
+		}
+
+		if ( inFrame ) {
+			mvDemo.entities[i] = ent->s;
+		}
+	}
+	MSG_WriteBits( &msg, ( MAX_GENTITIES - 1 ), GENTITYNUM_BITS );
+
+	// visibility info of the entities
+	for ( i = 0; i < numEntities && i < MAX_GENTITIES; i++ ) {
+		sharedEntity_t *ent = SV_GentityNum( i );
+		mvdEntityVis_t vis;
+
+		if ( !SV_MVDemoEntityInFrame( ent ) ) {
+			continue;
+		}
+
+		SV_MVDemoGetVis( i, ent, &vis );
+		if ( mvDemo.entityInFrame[i] && !memcmp( &vis, &mvDemo.vis[i], sizeof( vis ) ) ) {
+			continue;
+		}
+		mvDemo.vis[i] = vis;
+
+		MSG_WriteBits( &msg, i, GENTITYNUM_BITS );
+		MSG_WriteLong( &msg, vis.svFlags );
+		MSG_WriteShort( &msg, vis.singleClient );
+		MSG_WriteLong( &msg, vis.broadcastClients[0] );
+		MSG_WriteLong( &msg, vis.broadcastClients[1] );
+		MSG_WriteLong( &msg, vis.areanum );
+		MSG_WriteLong( &msg, vis.areanum2 );
+		MSG_WriteLong( &msg, vis.numClusters );
+		MSG_WriteLong( &msg, vis.lastCluster );
+		for ( int j = 0; j < vis.numClusters && j < MAX_ENT_CLUSTERS; j++ ) {
+			MSG_WriteLong( &msg, vis.clusternums[j] );
+		}
+	}
+	MSG_WriteBits( &msg, ( MAX_GENTITIES - 1 ), GENTITYNUM_BITS );
+
+	for ( i = 0; i < MAX_GENTITIES; i++ ) {
+		mvDemo.entityInFrame[i] = (byte)( i < numEntities && SV_MVDemoEntityInFrame( SV_GentityNum( i ) ) );
+	}
+
+	if ( msg.overflowed ) {
+		// the deltas of this frame are lost, start over from a keyframe
+		Com_Printf( "WARNING: multi-view demo frame overflowed\n" );
+		mvDemo.needKeyframe = qtrue;
+		return;
+	}
+
+	// keyframes are where a compressed demo can be entered
+	if ( keyframe ) {
+		FS_AsyncMark( mvDemo.file, sv.time );
+	}
+	SV_MVDemoWriteBlock( &msg );
+	mvDemo.frames++;
+}
+
+/*
+==================
+SV_StartMultiViewDemo
+
+Records all clients of the current map into one file
+==================
+*/
+void SV_StartMultiViewDemo( const char *demoName ) {
+	char name[MAX_OSPATH];
+
+	if ( mvDemo.recording || sv.state != SS_GAME ) {
+		return;
+	}
+
+	Q_strncpyz( mvDemo.name, demoName, sizeof( mvDemo.name ) );
+	Com_sprintf( name, sizeof( name ), "demos/%s%s", mvDemo.name, SV_DemoExtension( "mvd" ) );
+	Com_Printf( "recording to %s.\n", name );
+	if ( sv_demoCompress->integer ) {
+		mvDemo.file = FS_FOpenFileWriteCompressed( name );
+	} else {
+		mvDemo.file = FS_FOpenFileWriteAsync( name );
+	}
+	if ( !mvDemo.file ) {
+		Com_Printf( "ERROR: couldn't open.\n" );
+		return;
+	}
+
+	if ( !mvDemo.msgBuf ) {
+		mvDemo.msgBuf = (byte *)Z_Malloc( MVD_MSGLEN, TAG_GENERAL, qfalse );
+		mvDemo.entities = (entityState_t *)Z_Malloc( MAX_GENTITIES * sizeof( entityState_t ), TAG_GENERAL, qfalse );
+		mvDemo.vis = (mvdEntityVis_t *)Z_Malloc( MAX_GENTITIES * sizeof( mvdEntityVis_t ), TAG_GENERAL, qfalse );
+	}
+
+	mvDemo.recording = qtrue;
+	mvDemo.needKeyframe = qtrue;
+	mvDemo.lastKeyframe = sv.time;
+	mvDemo.lastFrameTime = -1;
+	mvDemo.frames = 0;
+	mvDemo.bytes = 0;
+	mvDemo.commands.clear();
+	Com_Memset( mvDemo.csChanged, 0, sizeof( mvDemo.csChanged ) );
+
+	SV_MVDemoWriteGamestate();
+}
+
+void SV_StopMultiViewDemo( void ) {
+	int len;
+
+	if ( !mvDemo.recording ) {
+		return;
+	}
+
+	len = -1;
+	FS_Write( &len, 4, mvDemo.file );
+	FS_FCloseFile( mvDemo.file );
+	mvDemo.file = 0;
+	mvDemo.recording = qfalse;
+	mvDemo.commands.clear();
+	mvDemo.commands.shrink_to_fit();
+
+	Com_Printf( "Stopped multi-view demo, %d frames, %d KB.\n", mvDemo.frames, mvDemo.bytes >> 10 );
+}
+
+qboolean SV_MultiViewDemoRecording( void ) {
+	return mvDemo.recording;
+}
+
+// called once per server frame after the game ran
+void SV_MultiViewDemoFrame( void ) {
+	if ( !mvDemo.recording || sv.time == mvDemo.lastFrameTime ) {
+		return;
+	}
+	mvDemo.lastFrameTime = sv.time;
+	SV_MVDemoWriteFrame();
+}
+
+// called for every command of SV_SendServerCommand, cl is NULL for broadcasts
+void SV_MultiViewDemoCommand( client_t *cl, const char *cmd ) {
+	if ( !mvDemo.recording ) {
+		return;
+	}
+
+	// configstrings are stored as they are, not as the commands updating them
+	if ( !Q_strncmp( cmd, "cs ", 3 ) || !Q_strncmp( cmd, "bcs", 3 ) ) {
+		return;
+	}
+
+	if ( cl ) {
+		// SV_AddServerCommand drops these too
+		if ( cl->state < CS_PRIMED ) {
+			return;
+		}
+		mvDemo.commands.emplace_back( (int)( cl - svs.clients ), cmd );
+	} else {
+		mvDemo.commands.emplace_back( MVD_BROADCAST, cmd );
+	}
+}
+
+void SV_MultiViewDemoConfigstring( int index ) {
+	if ( !mvDemo.recording ) {
+		return;
+	}
+	mvDemo.csChanged[index] = qtrue;
+}
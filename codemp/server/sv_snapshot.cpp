@@ -818,7 +818,7 @@ void SV_SendClientSnapshot( client_t *client ) {
 	// build the snapshot
 	SV_BuildClientSnapshot( client );
 
-	if ( sv_autoDemo->integer && !client->demo.demorecording ) {
+	if ( sv_autoDemo->integer && !sv_autoDemoMultiView->integer && !client->demo.demorecording ) {
 		if ( client->netchan.remoteAddress.type != NA_BOT || sv_autoDemoBots->integer ) {
 			SV_BeginAutoRecordDemos();
 		}
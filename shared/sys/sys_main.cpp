@@ -689,6 +689,7 @@ void Sys_SigHandler( int signal )
 #endif
 		SV_Shutdown(va("Received signal %d", signal) );
 		//VM_Forced_Unload_Done();
+		Com_FlushLog();
 	}
 
 	if( signal == SIGTERM || signal == SIGINT )